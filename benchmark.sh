@@ -0,0 +1,99 @@
+#!/bin/bash
+
+# Times binspector over generated inputs of doubling size. Each run should take about twice as
+# long as the one before it; anything worse means something has gone quadratic in the number of
+# nodes. Run smoke_test.sh (or build.sh) first to build the binary.
+
+echo_time ()
+{
+    echo "TIME : $@"
+    /usr/bin/time -p "$@" > /dev/null
+    r=$?
+    if test $r -ne 0 ; then
+        exit $r
+    fi
+}
+
+cd `dirname $0`
+
+if [ "$BUILDMODE" == "release" ] ; then
+    CURMODE="release"
+else
+    CURMODE="debug"
+fi
+
+BINPATH="./bin/$CURMODE/binspector"
+
+if [ ! -e 'samples' ]; then
+    mkdir 'samples'
+fi
+
+for SIZE in 262144 524288 1048576 ; do
+    ZEROSPATH="samples/zeros_$SIZE.bin"
+
+    if [ ! -e $ZEROSPATH ]; then
+        head -c $SIZE /dev/zero > $ZEROSPATH
+    fi
+
+    # large_array.bfft reads one element per byte, so the last run is a 1M-element array. text
+    # output visits every element's properties, which is where the parent walks were.
+    echo_time $BINPATH -t ./test/large_array.bfft -i $ZEROSPATH -m text
+done
+
+# Bit fields that start and end mid-byte should read about as fast as the same bits in whole bytes.
+BITSPATH="samples/zeros_1048576.bin"
+
+echo_time $BINPATH -t ./test/large_bitfields.bfft -i $BITSPATH -m validate -s aligned
+echo_time $BINPATH -t ./test/large_bitfields.bfft -i $BITSPATH -m validate -s unaligned
+
+# Truncated files are most of what a fuzzer feeds us, so time a corpus of them, too: the sample
+# JPEG cut short at every 64th of its length. Most of them fail validation, which is expected.
+# (smoke_test.sh downloads the sample.)
+JPEGPATH='samples/sample.jpg'
+TRUNCATEDPATH='samples/truncated'
+
+if [ -e $JPEGPATH ]; then
+    if [ ! -e $TRUNCATEDPATH ]; then
+        mkdir $TRUNCATEDPATH
+
+        JPEGSIZE=`wc -c < $JPEGPATH`
+
+        for STEP in `seq 1 63` ; do
+            head -c $((JPEGSIZE * STEP / 64)) $JPEGPATH > $TRUNCATEDPATH/sample_$STEP.jpg
+        done
+    fi
+
+    echo "TIME : $BINPATH -t ./bfft/jpg.bfft -m validate over $TRUNCATEDPATH"
+    /usr/bin/time -p bash -c \
+        "for F in $TRUNCATEDPATH/*.jpg ; do $BINPATH -t ./bfft/jpg.bfft -i \$F -m validate ; done" \
+        > /dev/null
+else
+    echo "INFO : $JPEGPATH not found; skipping the truncated corpus."
+fi
+
+# Array elements are analyzed on other threads with --parallel; time the sample PNG with and
+# without it. (smoke_test.sh downloads the sample.)
+PNGPATH='samples/sample.png'
+
+if [ -e $PNGPATH ]; then
+    echo_time $BINPATH -t ./bfft/png.bfft -i $PNGPATH -m validate
+    echo_time $BINPATH -t ./bfft/png.bfft -i $PNGPATH -m validate --parallel
+else
+    echo "INFO : $PNGPATH not found; skipping the parallel comparison."
+fi
+
+# Template expressions are compiled to bytecode; --interpret evaluates them with the ASL virtual
+# machine instead, as before they were compiled. Time each sample format both ways in text mode,
+# which evaluates every field. (smoke_test.sh downloads the JPEG and PNG samples; put a TIFF at
+# samples/sample.tif to time that format too.)
+for SAMPLE in 'png samples/sample.png' 'jpg samples/sample.jpg' 'tiff samples/sample.tif' ; do
+    FORMAT=${SAMPLE% *}
+    SAMPLEPATH=${SAMPLE#* }
+
+    if [ -e $SAMPLEPATH ]; then
+        echo_time $BINPATH -t ./bfft/$FORMAT.bfft -i $SAMPLEPATH -m text
+        echo_time $BINPATH -t ./bfft/$FORMAT.bfft -i $SAMPLEPATH -m text --interpret
+    else
+        echo "INFO : $SAMPLEPATH not found; skipping the $FORMAT bytecode comparison."
+    fi
+done
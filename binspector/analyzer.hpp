@@ -9,8 +9,14 @@
 #define BINSPECTOR_ANALYZER_HPP
 
 // stdc++
+#include <deque>
+#include <exception>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <vector>
 
 // boost
 #include <boost/cstdint.hpp>
@@ -22,9 +28,13 @@
 #include <adobe/dictionary.hpp>
 #include <adobe/forest.hpp>
 
+// stlab
+#include <stlab/concurrency/future.hpp>
+
 // application
 #include <binspector/bitreader.hpp>
 #include <binspector/common.hpp>
+#include <binspector/expression.hpp>
 
 /****************************************************************************************************/
 
@@ -35,9 +45,155 @@ public:
     typedef adobe::closed_hash_map<adobe::name_t, adobe::copy_on_write<adobe::dictionary_t>>
         typedef_map_t;
 
-    explicit binspector_analyzer_t(std::istream& binary_file,
-                                   std::ostream& output,
-                                   std::ostream& error);
+    // Once parsing is done every field is lowered from its dictionary into a descriptor, so
+    // analysis never has to look anything up by key (see compile_structures).
+    enum field_kind_t {
+        field_kind_atom_k,
+        field_kind_const_k,
+        field_kind_die_k,
+        field_kind_enumerated_k,
+        field_kind_enumerated_option_k,
+        field_kind_enumerated_default_k,
+        field_kind_invariant_k,
+        field_kind_named_k,
+        field_kind_notify_k,
+        field_kind_sentry_k,
+        field_kind_signal_k,
+        field_kind_skip_k,
+        field_kind_slot_k,
+        field_kind_struct_k,
+        field_kind_summary_k,
+        field_kind_typedef_atom_k,
+        field_kind_typedef_named_k,
+    };
+
+    struct field_descriptor_t;
+    struct enumeration_t;
+
+    typedef std::vector<field_descriptor_t> compiled_structure_t;
+    typedef adobe::closed_hash_map<adobe::name_t, compiled_structure_t> compiled_structure_map_t;
+    typedef std::deque<compiled_expression_t> expression_pool_t; // stable addresses
+    typedef std::deque<enumeration_t>         enumeration_pool_t; // ditto
+
+    // [first, last) byte offsets into the binary file
+    typedef std::vector<std::pair<boost::uint64_t, boost::uint64_t>> byte_range_set_t;
+
+    struct field_descriptor_t {
+        field_kind_t                kind_m;
+        adobe::name_t               name_m;
+        adobe::name_t               type_name_m; // the structure or typedef the field names
+        const compiled_structure_t* structure_m; // type_name_m's structure, if known
+        conditional_expression_t    conditional_m;
+        field_size_t                size_type_m;
+        atom_base_type_t            base_type_m;
+        bool                        shuffle_m;
+        bool                        no_print_m;
+        bool                        isolated_m; // needs nothing outside its array element
+        bool                        referenced_m; // an expression might look it up
+        bool                        elements_referenced_m; // arrays: or one of its elements
+        bool                        lazy_m; // sentries: the body can wait; see mark_lazy_sentries
+        bool                        pure_m; // summaries: can be rendered later; see summary_of
+
+        // never null; absent expressions point to an empty one.
+        const compiled_expression_t* expression_m; // the one expression particular to the kind
+        const compiled_expression_t* size_expression_m;
+        const compiled_expression_t* offset_expression_m;
+        const compiled_expression_t* alignment_expression_m;
+        const compiled_expression_t* bit_count_expression_m;
+        const compiled_expression_t* is_big_endian_expression_m;
+
+        // enumerated fields whose options are all numeric constants; null otherwise.
+        const enumeration_t* enumeration_m;
+
+        adobe::name_t   filename_m;
+        boost::uint32_t line_number_m;
+    };
+
+    // An enumerate block tabled by option value, so dispatch is one probe instead of an
+    // evaluation per option (see compile_enumerations).
+    struct enumeration_t {
+        typedef adobe::closed_hash_map<double, const field_descriptor_t*> option_map_t;
+
+        option_map_t              option_map_m;
+        adobe::array_t            option_set_m; // every option value, in order
+        const field_descriptor_t* default_m;    // may be null
+    };
+
+    // The typedefs in scope during analysis. A structure's typedefs are defined as it is analyzed
+    // and rolled back when it is left, so entering a structure copies nothing. Chains of named
+    // typedefs are resolved once and reused until one of the names they pass through changes.
+    class typedef_scope_t {
+    public:
+        typedef std::size_t mark_t;
+
+        typedef_scope_t() : generation_m(1) {}
+
+        // a scope starting with base's typedefs, which is shared rather than copied, e.g., between
+        // workers. base is only read, and so is never resolved through its own cache.
+        explicit typedef_scope_t(std::shared_ptr<const typedef_scope_t> base)
+            : base_m(std::move(base)), generation_m(1) {}
+
+        void clear();
+
+        mark_t mark() const {
+            return undo_m.size();
+        }
+
+        void define(const field_descriptor_t& field);
+
+        // changes whenever the typedefs in scope do.
+        boost::uint64_t generation() const {
+            return generation_m;
+        }
+
+        // undefines everything defined since mark, restoring whatever the definitions hid.
+        void rollback(mark_t mark);
+
+        // the named field with its type resolved to an atom or a structure.
+        field_descriptor_t resolve(field_descriptor_t field) const;
+
+        // rolls back the typedefs defined during its lifetime, e.g., by one structure.
+        struct guard_t {
+            explicit guard_t(typedef_scope_t& scope) : scope_m(scope), mark_m(scope.mark()) {}
+
+            ~guard_t() {
+                scope_m.rollback(mark_m);
+            }
+
+            typedef_scope_t& scope_m;
+            mark_t           mark_m;
+        };
+
+    private:
+        struct entry_t {
+            const field_descriptor_t* typedef_m; // null once rolled back
+
+            // the resolution of typedef_m, good until a name it passed through is set again.
+            mutable bool                      resolved_m;
+            mutable const field_descriptor_t* named_m; // the last named typedef in the chain
+            mutable const field_descriptor_t* atom_m;  // the atom typedef ending it, if any
+        };
+
+        typedef adobe::closed_hash_map<adobe::name_t, entry_t> table_t;
+        typedef std::vector<std::pair<adobe::name_t, const field_descriptor_t*>> undo_log_t;
+        typedef adobe::closed_hash_map<adobe::name_t, std::vector<adobe::name_t>> dependent_map_t;
+
+        const field_descriptor_t* find(adobe::name_t name) const;
+        void set(adobe::name_t name, const field_descriptor_t* field);
+
+        std::shared_ptr<const typedef_scope_t> base_m; // what table_m doesn't name
+
+        table_t         table_m;
+        undo_log_t      undo_m; // each definition and the one it hid
+        boost::uint64_t generation_m;
+
+        // each name, and the names whose resolutions passed through it
+        mutable dependent_map_t dependents_m;
+    };
+
+    explicit binspector_analyzer_t(const boost::filesystem::path& binary_path,
+                                   std::ostream&                  output,
+                                   std::ostream&                  error);
 
     // if the structure has not been previously specified it will be created
     void set_current_structure(adobe::name_t structure_name);
@@ -51,9 +207,44 @@ public:
 
     void set_quiet(bool quiet);
 
+    // Analyze the bodies of length-prefixed array elements on other threads; see speculate_array.
+    void set_parallel(bool parallel);
+
+    // Give nodes only to the fields something could look up, e.g., to validate a file rather than
+    // show it. The rest are still placed. See mark_referenced_fields.
+    void set_skeleton(bool skeleton);
+
+    // Erase the nodes nothing could look up as soon as they are done, so the forest grows with how
+    // deeply the file nests rather than with how big it is. See finish_node.
+    void set_streaming(bool streaming);
+
+    // Keep count of the most nodes the forest holds at once, e.g., to check set_streaming keeps it
+    // small. Counting takes time of its own.
+    void set_node_stats(bool node_stats);
+
+    std::size_t peak_node_count() const {
+        return peak_node_count_m;
+    }
+
+    // Leave the bodies of sentries to be analyzed the first time anything looks inside them (see
+    // expand_node), e.g., to get to an interactive prompt sooner.
+    void set_lazy(bool lazy);
+
+    // Keep what reanalyze needs to pick analysis up partway through the file. See checkpoint. The
+    // output and error streams have to be able to seek (e.g., string streams): reanalyze takes them
+    // back to where they were at the checkpoint, and writes over whatever followed.
+    void set_incremental(bool incremental);
+
     // analysis and results routines
     bool analyze_binary(const std::string& starting_struct);
 
+    // Analyzes binary_path, which differs from the file last analyzed only in the modified ranges,
+    // keeping as much of forest -- the one that analysis left -- as the edits could not have
+    // changed. Analyzes it from the start if there is nothing to keep.
+    bool reanalyze(auto_forest_t                  forest,
+                   const boost::filesystem::path& binary_path,
+                   const byte_range_set_t&        modified);
+
     auto_forest_t forest() {
         return std::move(forest_m);
     }
@@ -62,12 +253,206 @@ public:
         return structure_map_m;
     }
 
+    // the reader over the binary file, e.g., to tune its cache or read its hit counters.
+    bitreader_t& input() {
+        return input_m;
+    }
+
 private:
+    // What a frame's current field has left to do once the frame it pushed is done.
+    enum pending_kind_t {
+        pending_none_k,
+        pending_enumerated_k,        // check an option was found, then restore the enumeration
+        pending_enumerated_option_k, // note the option was found
+        pending_sentry_k,            // lift the sentry and check it was reached
+        pending_node_k,              // the field has a node but pushes no frame
+        pending_struct_k,            // finish the struct's node
+        pending_struct_array_k,      // push the next element or finish the array's node
+    };
+
+    struct pending_t {
+        pending_kind_t            kind_m;
+        const field_descriptor_t* field_m;
+        inspection_branch_t       sub_branch_m; // the field's node, once it has one
+
+        // enumerated fields
+        inspection_branch_t       atom_m;
+        const field_descriptor_t* option_m; // the tabled option pushed, if any
+
+        // fields with nodes
+        inspection_position_t position_save_m;
+        bool                  remote_position_m;
+        std::size_t           size_count_m;
+        boost::uint64_t       delimiter_m;
+        std::size_t           delimiter_byte_count_m;
+
+        // sentry fields
+        bitreader_t::pos_t sentry_position_m;
+
+        // the analyzer state the field replaced, put back when it is done
+        adobe::any_regular_t saved_enumerated_value_m;
+        bool                 saved_enumerated_found_m;
+        adobe::array_t       saved_enumerated_option_set_m;
+        bitreader_t::pos_t   saved_sentry_m;
+        std::string          saved_sentry_set_path_m;
+    };
+
+    // One structure being analyzed; see analyze_with_structure.
+    struct frame_t {
+        const compiled_structure_t*          structure_m;
+        compiled_structure_t::const_iterator iter_m; // the next field
+        inspection_branch_t                  parent_m;
+        inspection_branch_t                  entry_leaf_m; // current_leaf_m before the push
+        typedef_scope_t::mark_t              typedef_mark_m;
+        bool                                 last_conditional_value_m;
+        field_descriptor_t                   resolved_m; // the current field, if it was named
+        pending_t                            pending_m;
+    };
+
+    typedef std::deque<frame_t> frame_stack_t; // frames stay put as others are pushed
+
+    // An array element analyzed ahead of the ones before it; see speculate_array.
+    struct speculated_element_t {
+        std::size_t           index_m;
+        inspection_branch_t   element_m;
+        inspection_position_t position_m;        // where the element starts
+        inspection_position_t root_end_offset_m; // the array root's, before the element
+        bool                  failed_m;          // its header or trailer could not be analyzed
+
+        // the element's body, analyzed by a worker with a copy of the element's header
+        bool                                   deferred_m;
+        std::size_t                            header_count_m;
+        inspection_position_t                  start_offset_m; // the element's, once the body is in
+        inspection_position_t                  end_offset_m;   // ditto
+        const compiled_expression_t*           summary_expression_m; // the element's, pre-trailer
+        std::shared_ptr<std::stringstream>     messages_m;
+        std::shared_ptr<binspector_analyzer_t> worker_m;
+        stlab::future<bool>                    body_m;
+    };
+
+    typedef std::deque<speculated_element_t> speculation_t;
+
+    // A node still being added to at a checkpoint, as it was then.
+    struct open_node_t {
+        inspection_branch_t          branch_m;
+        inspection_branch_t          last_child_m; // null if it had none
+        inspection_position_t        start_offset_m;
+        inspection_position_t        end_offset_m;
+        boost::uint64_t              cardinal_m;
+        std::string                  summary_m;
+        const compiled_expression_t* summary_expression_m;
+        bool                         summary_rendered_m;
+    };
+
+    // The analyzer between two fields of main, or two elements of an array in it; see checkpoint.
+    struct checkpoint_t {
+        frame_t                                frame_m; // main's, the only one
+        std::vector<open_node_t>               open_nodes_m;
+        std::shared_ptr<const typedef_scope_t> typedef_scope_m;
+        inspection_branch_t                    current_leaf_m;
+        adobe::any_regular_t                   current_enumerated_value_m;
+        adobe::array_t                         current_enumerated_option_set_m;
+        bool                                   current_enumerated_found_m;
+        bitreader_t::pos_t                     current_sentry_m;
+        std::string                            current_sentry_set_path_m;
+        bool                                   eof_signalled_m;
+        inspection_position_t                  position_m;
+        inspection_position_t                  reach_m;
+        std::size_t                            signal_count_m; // the signals before it
+        std::streampos                         output_mark_m;  // what had been written by then
+        std::streampos                         error_mark_m;
+    };
+
+    // A slot a signal changed, and the expression it had before. The slot is not followed unless
+    // it is still in the forest: the node it was in may have been erased since.
+    struct signal_record_t {
+        forest_node_t*               slot_m;
+        adobe::array_t               expression_m;
+        const compiled_expression_t* compiled_expression_m;
+    };
+
+    // A sentry's body left for later; see defer_sentry.
+    struct deferred_body_t : expansion_t {
+        void expand(inspection_branch_t branch) override {
+            analyzer_m->expand_body(branch, *this);
+        }
+
+        binspector_analyzer_t*                 analyzer_m;
+        inspection_forest_t*                   forest_m;
+        const compiled_structure_t*            structure_m;
+        inspection_position_t                  position_m;
+        bitreader_t::pos_t                     sentry_position_m;
+        std::shared_ptr<const typedef_scope_t> typedef_scope_m;
+        inspection_branch_t                    last_header_m; // the node's last child before it
+        const compiled_expression_t*           summary_expression_m; // the node's, before it
+    };
+
+    // a worker over the same binary and templates as owner, with a fresh forest. It shares a
+    // snapshot of the typedefs owner has in scope rather than copying them.
+    binspector_analyzer_t(binspector_analyzer_t& owner, std::ostream& messages);
+
     // inspection related
-    inspection_branch_t new_branch(inspection_branch_t with_parent);
-    bool analyze_with_structure(const structure_type& structure, inspection_branch_t parent);
-    const structure_type& structure_for(adobe::name_t structure_name);
+    // a named branch is indexed in its parent (see index_child).
+    inspection_branch_t new_branch(inspection_branch_t with_parent,
+                                   adobe::name_t       name = adobe::name_t());
+    // appends an element to an explicit array, bumping the root's cardinal.
+    inspection_branch_t new_array_element(inspection_branch_t root);
+    void compile_structures();
+    void compile_enumerations();
+    void mark_referenced_fields();
+    void mark_lazy_sentries();
+    void mark_pure_summaries();
+    bool analyze_with_structure(const compiled_structure_t& structure, inspection_branch_t parent);
+    // analyzes until the frames above base are done.
+    bool run_frames(frame_stack_t::size_type base);
+    void push_frame(const compiled_structure_t& structure, inspection_branch_t parent);
+    void pop_frame();
+    void restore_pending(frame_t& frame);
+    // these return false if the field ran into the end of the file; see end_of_file.
+    bool analyze_field(frame_t& frame);
+    bool resume_field(frame_t& frame);
+    // moves past an atom or skip field the way analyze_field would, without adding its node.
+    bool place_field(frame_t& frame, const field_descriptor_t& field);
+    void end_of_file(std::exception_ptr& exception);
+    void finish_enumerated(frame_t& frame);
+    // whether the pending struct array has another element.
+    bool more_struct_elements(frame_t& frame);
+    // pushes a frame for the next element of the pending struct array; false once it's complete.
+    bool next_struct_element(frame_t& frame);
+    // analyzes elements of the pending struct array ahead; true if that completed the array.
+    bool speculate_array(frame_t& frame);
+    bool speculate_element(inspection_branch_t                  root,
+                           const compiled_structure_t&          structure,
+                           compiled_structure_t::const_iterator split,
+                           speculated_element_t&                element);
+    void defer_body(const field_descriptor_t& sentry, speculated_element_t& element);
+    bool analyze_body(const compiled_structure_t& structure,
+                      inspection_position_t       position,
+                      inspection_position_t       sentry_position,
+                      const std::string&          sentry_set_path);
+    // splices in the body of the oldest element; false if it must be analyzed again in order.
+    bool commit_body(speculated_element_t& element);
+    void roll_back(inspection_branch_t root, const speculated_element_t& element);
+    bitreader_t::pos_t sentry_position_for(const field_descriptor_t& field);
+    // leaves the body of the sentry to be analyzed later; false if it must be analyzed now.
+    bool defer_sentry(inspection_branch_t       parent,
+                      const field_descriptor_t& sentry,
+                      bitreader_t::pos_t        sentry_position);
+    void expand_body(inspection_branch_t branch, const deferred_body_t& body);
+    void finish_node(frame_t& frame);
+    // erases the children of a struct that is done that nothing outside it could look up.
+    void drop_local_children(inspection_branch_t branch);
+    // the typedefs in scope, copied only when they have changed since the last time.
+    const std::shared_ptr<const typedef_scope_t>& typedef_snapshot();
+    void checkpoint();
+    // puts the analyzer and the forest back the way they were at the checkpoint.
+    void restore(const checkpoint_t& checkpoint);
+    // changes slot's expression to expression, noting what it was for restore.
+    void signal_slot(inspection_branch_t slot, const compiled_expression_t& expression);
+    const compiled_structure_t& structure_for(adobe::name_t structure_name);
+    const compiled_structure_t& structure_for(const field_descriptor_t& field);
 
+    // Returns invalid_position_k, rather than throwing, if the file has already ended.
     inspection_position_t make_location(boost::uint64_t bit_count) {
         if (current_sentry_m != invalid_position_k && input_m.pos() >= current_sentry_m) {
             // NOT std::out_of_range -- we use that for the document EOF
@@ -75,18 +460,47 @@ private:
             error_m << current_sentry_set_path_m << " sentry barrier breach\n";
         }
 
+        // the same test bitreader_t::advance would throw on
+        if (bit_count != 0 && input_m.eof())
+            return invalid_position_k;
+
         return input_m.advance(bitpos(bit_count));
     }
 
+    // Equivalent to count calls to make_location; returns the first location, or
+    // invalid_position_k if the last one would start at or past the end of the file.
+    inspection_position_t make_array_location(boost::uint64_t bit_count, boost::uint64_t count) {
+        inspection_position_t first(input_m.pos());
+
+        if (count == 0 || bit_count == 0)
+            return first;
+
+        inspection_position_t last(first + bitpos(bit_count * (count - 1)));
+
+        if (current_sentry_m != invalid_position_k && last >= current_sentry_m)
+            error_m << current_sentry_set_path_m << " sentry barrier breach\n";
+
+        // The last element has to start before the end of the file, same as any other atom.
+        if (last >= input_m.size())
+            return invalid_position_k;
+
+        input_m.seek(last + bitpos(bit_count));
+
+        return first;
+    }
+
     std::string build_path(const_inspection_branch_t branch) {
         return ::build_path(forest_m->begin(), branch);
     }
 
     bool jump_into_structure(adobe::name_t structure_name, inspection_branch_t parent);
 
-    bool jump_into_structure(const adobe::dictionary_t& field, inspection_branch_t parent);
     template <typename T>
-    T eval_here(const adobe::array_t& expression);
+    T eval_here(const compiled_expression_t& expression);
+
+    // false, leaving result alone, if the expression reads past the end of the file.
+    template <typename T>
+    bool eval_here(const compiled_expression_t& expression, T& result);
 
     template <typename T>
     T identifier_lookup(adobe::name_t identifier);
@@ -97,25 +511,52 @@ private:
         return build_path(current_leaf_m);
     }
 
-    bitreader_t          input_m;
-    std::ostream&        output_m;
-    std::ostream&        error_m;
-    structure_map_t      structure_map_m;
-    structure_type*      current_structure_m;
-    inspection_branch_t  current_leaf_m;
-    typedef_map_t        current_typedef_map_m;
-    adobe::any_regular_t current_enumerated_value_m;
-    adobe::array_t       current_enumerated_option_set_m;
-    bool                 current_enumerated_found_m;
-    bitreader_t::pos_t   current_sentry_m;
-    std::string          current_sentry_set_path_m;
-    auto_forest_t        forest_m;
-    bool                 eof_signalled_m;
-    bool                 quiet_m;
+    bitreader_t              input_m;
+    std::ostream&            output_m;
+    std::ostream&            error_m;
+    structure_map_t          structure_map_m;
+    compiled_structure_map_t compiled_structure_map_m;
+    expression_pool_t        expression_pool_m;
+    enumeration_pool_t       enumeration_pool_m;
+    structure_type*          current_structure_m;
+    inspection_branch_t      current_leaf_m;
+    typedef_scope_t          typedef_scope_m;
+    frame_stack_t            frames_m;
+    adobe::any_regular_t     current_enumerated_value_m;
+    adobe::array_t           current_enumerated_option_set_m;
+    bool                     current_enumerated_found_m;
+    bitreader_t::pos_t       current_sentry_m;
+    std::string              current_sentry_set_path_m;
+    auto_forest_t            forest_m;
+    bool                     eof_signalled_m;
+    bool                     quiet_m;
+    bool                     parallel_m;
+    bool                     skeleton_m;
+    bool                     streaming_m;
+    bool                     lazy_m;
+    bool                     incremental_m;
+    bool                     worker_m;    // analyzing a body out of order, e.g., in analyze_body
+    bool                     expanding_m; // analyzing a deferred body on demand; see expand_body
+    bool                     node_stats_m;
+    std::size_t              peak_node_count_m;
+
+    // the names a field could be looked up by once the struct it is in is done
+    std::set<adobe::name_t> late_names_m;
+
+    // the typedefs in scope, shared by the bodies deferred while they stay the same
+    std::shared_ptr<const typedef_scope_t> typedef_snapshot_m;
+
+    // what reanalyze starts from, in the order they were taken
+    adobe::name_t                starting_struct_m;
+    const inspection_forest_t*   analyzed_forest_m; // the forest they are checkpoints in
+    std::vector<checkpoint_t>    checkpoints_m;
+    std::vector<signal_record_t> signal_log_m;
+    std::streampos               output_start_m; // the streams when analysis started
+    std::streampos               error_start_m;
 
     // Error reporting helper variables
     adobe::name_t last_name_m;
-    std::string   last_filename_m;
+    adobe::name_t last_filename_m;
     uint32_t      last_line_number_m;
 };
 
@@ -10,6 +10,8 @@
 
 // stdc++
 #include <istream>
+#include <limits>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -18,6 +20,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/operators.hpp>
+#include <boost/range/iterator_range.hpp>
 
 // asl
 #include <adobe/string.hpp>
@@ -30,6 +33,9 @@
 
 typedef std::vector<boost::uint8_t> rawbytes_t;
 
+// A non-owning view of bytes read from the input; see bitreader_t::read_view.
+typedef boost::iterator_range<const boost::uint8_t*> rawview_t;
+
 /****************************************************************************************************/
 
 inline boost::uint64_t bytesize(boost::uint64_t bits) {
@@ -40,6 +46,41 @@ inline boost::uint8_t bitsize(boost::uint64_t bits) {
     return bits & 7; // zero out all but first 3 bits (bits % 8)
 }
 
+/****************************************************************************************************/
+/*
+    A read-only mapping of an entire file into memory. If the file cannot be mapped (it is empty,
+    not a regular file, or the platform is unsupported) the mapping is left closed and the caller
+    is expected to fall back to stream-based reads.
+*/
+class mapped_file_t {
+public:
+    explicit mapped_file_t(const boost::filesystem::path& path);
+    ~mapped_file_t();
+
+    mapped_file_t(const mapped_file_t&) = delete;
+    mapped_file_t& operator=(const mapped_file_t&) = delete;
+
+    bool is_open() const {
+        return data_m != nullptr;
+    }
+    const boost::uint8_t* data() const {
+        return data_m;
+    }
+    boost::uint64_t size() const {
+        return size_m;
+    }
+
+private:
+    const boost::uint8_t* data_m;
+    boost::uint64_t       size_m;
+};
+
+/****************************************************************************************************/
+
+// Defaults for the block cache bitreader_t puts in front of stream reads; see set_cache.
+static const std::size_t default_cache_block_size_k  = 64 * 1024;
+static const std::size_t default_cache_block_count_k = 16;
+
 /****************************************************************************************************/
 
 struct bitreader_t {
@@ -135,6 +176,9 @@ struct bitreader_t {
 
     explicit bitreader_t(std::istream& input);
 
+    // Memory maps the file when possible, otherwise reads it through a privately owned stream.
+    explicit bitreader_t(const boost::filesystem::path& path);
+
     void seek(const pos_t& position);     // absolute
     pos_t advance(const pos_t& position); // relative; returns old position
 
@@ -151,6 +195,20 @@ struct bitreader_t {
         return position_m;
     }
 
+    // How far into the input the reader has been: past every byte read so far and every position
+    // sought or advanced to. Nothing at or after it has had a say in what was read. Reads only move
+    // the position forward, so it is noted as the position moves back (see seek), not per read.
+    pos_t reach() const {
+        return reach_m < position_m ? position_m : reach_m;
+    }
+    void set_reach(const pos_t& reach) {
+        reach_m = reach;
+    }
+
+    // The bits need not start or end on a byte boundary. They are returned right-justified in the
+    // fewest bytes that will hold them, so the leading byte is the partial one: e.g., a 12 bit read
+    // yields its first four bits in the low nibble of the first byte and the other eight in the
+    // second.
     // The failbit/eofbit state will throw a std::out_of_range. (i.e., reading past eof)
     // All other failbit states will throw a std::runtime_error.
     // In either case the stream will not be cleared of its failbit state.
@@ -171,15 +229,106 @@ struct bitreader_t {
                     (end_position - start_position + bitreader_t::pos_t(1, 0)).bytes());
     }
 
+    // Same as the above, but without taking a copy of the bytes. When the input is memory mapped
+    // and the read is byte aligned the view points directly into the mapping and remains valid for
+    // the lifetime of the reader. Otherwise the view refers to an internal buffer that is only
+    // valid until the next call to one of these routines.
+    rawview_t read_bits_view(boost::uint64_t bits);
+    rawview_t read_bits_view(const pos_t& position, boost::uint64_t bits) {
+        seek(position);
+        return read_bits_view(bits);
+    }
+
+    rawview_t read_view(boost::uint64_t bytes) {
+        return read_bits_view(bytes << 3);
+    }
+    rawview_t read_view(const pos_t& position, boost::uint64_t bytes) {
+        return read_bits_view(position, bytes << 3);
+    }
+
+    // Reads up to 64 bits and assembles them into an integer of the given byte order without
+    // allocating. The bytes are laid out as they are for read_bits and the result is
+    // zero-extended.
+    boost::uint64_t read_uint(boost::uint64_t bits, bool is_big_endian);
+    boost::uint64_t read_uint(const pos_t& position, boost::uint64_t bits, bool is_big_endian) {
+        seek(position);
+        return read_uint(bits, is_big_endian);
+    }
+
+    static constexpr boost::uint64_t not_found_k = std::numeric_limits<boost::uint64_t>::max();
+
+    // Returns the distance in bytes from the current position to the first occurrence of the
+    // size byte pattern, considering only distances that are a multiple of stride. The position is
+    // left where it was. Returns not_found_k if the input ends before the pattern is found.
+    boost::uint64_t find(const boost::uint8_t* pattern, std::size_t size, std::size_t stride = 1);
+
+    bool mapped() const {
+        return mapped_m != nullptr;
+    }
+
+    // Stream reads are served from an LRU cache of block_count blocks, each block_size bytes and
+    // aligned to that size, so seeking back to reread a few bytes costs no I/O. A block_count of
+    // zero turns the cache off. The mapping is already a page cache, so mapped readers skip it.
+    void set_cache(std::size_t block_size, std::size_t block_count);
+
+    boost::uint64_t cache_hits() const {
+        return cache_hits_m;
+    }
+    boost::uint64_t cache_misses() const {
+        return cache_misses_m;
+    }
+
+    std::size_t cache_block_size() const {
+        return cache_block_size_m;
+    }
+    std::size_t cache_block_count() const {
+        return cache_block_count_m;
+    }
+
 private:
-    void lazy_seek();
-
-    std::istream&  input_m;
-    pos_t          size_m;
-    pos_t          position_m;
-    bool           saught_m;
-    boost::uint8_t remainder_bits_m; // leftover bits from the last read
-    boost::uint8_t remainder_size_m; // number of valid bits in the above (lowest)
+    struct block_t {
+        boost::uint64_t index_m;    // offset into the input in units of the block size
+        boost::uint64_t last_use_m; // cache_tick_m when the block was last read from
+        rawbytes_t      bytes_m;    // short only for the last block of the input
+    };
+
+    void init_stream();
+
+    void extend_reach(const pos_t& position) {
+        if (reach_m < position)
+            reach_m = position;
+    }
+
+    void read_bits_into(boost::uint64_t bits, rawbytes_t& result);
+    const block_t& cached_block(boost::uint64_t index);
+
+    // Reads size bytes at first from the stream into dst and returns the number read. Unless
+    // short_ok is set, reading fewer than size bytes throws as read_bits does.
+    std::size_t read_stream(boost::uint64_t first,
+                            boost::uint8_t* dst,
+                            std::size_t     size,
+                            bool            short_ok);
+
+    // Returns the bytes [first, first + size) of the input: a pointer into the mapping if there is
+    // one, otherwise scratch after the stream has been read into it.
+    const boost::uint8_t* fetch(boost::uint64_t first, boost::uint64_t size, rawbytes_t& scratch);
+
+    std::shared_ptr<std::istream>        owned_input_m; // set when a path could not be mapped
+    std::istream*                        input_m;       // null when reading from the mapping
+    std::shared_ptr<const mapped_file_t> mapping_m;     // shared so readers stay copyable
+    const boost::uint8_t*                mapped_m;      // first byte of the mapping, if any
+    pos_t                                size_m;
+    pos_t                                position_m;
+    pos_t                                reach_m;
+    boost::uint64_t                      stream_head_m; // byte offset of the stream's read head
+    rawbytes_t                           buffer_m;      // backs views not into the mapping
+    rawbytes_t                           scratch_m;     // source bytes of unaligned stream reads
+    std::vector<block_t>                 cache_m;
+    std::size_t                          cache_block_size_m;
+    std::size_t                          cache_block_count_m;
+    boost::uint64_t                      cache_tick_m;
+    boost::uint64_t                      cache_hits_m;
+    boost::uint64_t                      cache_misses_m;
 };
 
 inline bitreader_t::pos_t bytepos(boost::uint64_t bytes) {
@@ -216,11 +365,10 @@ private:
 class async_bitreader {
     struct impl : std::enable_shared_from_this<impl> {
         stlab::serial_queue_t queue_m;
-        std::ifstream         stream_m;
         bitreader_t           reader_m;
 
         impl(const boost::filesystem::path& path)
-            : queue_m(stlab::default_executor), stream_m(path.string()), reader_m(stream_m) {}
+            : queue_m(stlab::default_executor), reader_m(path) {}
 
         ~impl() {}
 
@@ -20,6 +20,7 @@
 #include <adobe/dictionary.hpp>
 
 // application
+#include <binspector/expression.hpp>
 #include <binspector/forest.hpp>
 
 /****************************************************************************************************/
@@ -31,6 +32,10 @@ adobe::any_regular_t evaluate(const rawbytes_t& raw,
                               boost::uint64_t   bit_length,
                               atom_base_type_t  base_type,
                               bool              is_big_endian);
+adobe::any_regular_t evaluate(const rawview_t& raw,
+                              boost::uint64_t  bit_length,
+                              atom_base_type_t base_type,
+                              bool             is_big_endian);
 adobe::any_regular_t fetch_and_evaluate(bitreader_t&                 input,
                                         const inspection_position_t& location,
                                         boost::uint64_t              bit_count,
@@ -72,6 +77,23 @@ inspection_position_t ending_offset_for(inspection_branch_t branch);
 
 /****************************************************************************************************/
 
+// A struct's summary is rendered the first time it is asked for, so a summary that would render the
+// same then as during analysis is only paid for if it is shown (see mark_pure_summaries). The
+// expression is evaluated with the struct as the current node.
+const std::string& summary_of(inspection_branch_t main,
+                              inspection_branch_t branch,
+                              bitreader_t&        input);
+
+/****************************************************************************************************/
+
+// A const or slot's value, evaluated where it was declared with the expression the template
+// compiled for it, rather than compiling the node's expression again.
+adobe::any_regular_t declared_value_of(inspection_branch_t main,
+                                       inspection_branch_t branch,
+                                       bitreader_t&        input);
+
+/****************************************************************************************************/
+
 std::string build_path(const_inspection_branch_t main, const_inspection_branch_t branch);
 
 /****************************************************************************************************/
@@ -102,6 +124,52 @@ inspection_branch_t contextual_evaluation_of(const adobe::array_t& expression,
 
 /****************************************************************************************************/
 
+// As contextual_evaluation_of, but an expression that reads past the end of the file sets
+// end_of_file and yields an empty value rather than throwing std::out_of_range; truncated files
+// are the common case. Paths given by name, and expressions evaluated by the ASL virtual machine,
+// still throw.
+adobe::any_regular_t contextual_evaluation_of(const compiled_expression_t& expression,
+                                              inspection_branch_t          main_branch,
+                                              inspection_branch_t          current_branch,
+                                              bitreader_t&                 input,
+                                              bool&                        end_of_file);
+
+/****************************************************************************************************/
+
+// Evaluates every expression with the ASL virtual machine, as before they were compiled, instead of
+// only those the bytecode does not cover; e.g., to time one against the other. Set it before any
+// analysis starts.
+void set_interpret_expressions(bool interpret);
+
+/****************************************************************************************************/
+
+// Expressions evaluated more than once should be compiled once up front and evaluated here.
+template <typename T>
+T contextual_evaluation_of(const compiled_expression_t& expression,
+                           inspection_branch_t          main_branch,
+                           inspection_branch_t          current_branch,
+                           bitreader_t&                 input) {
+    return contextual_evaluation_of<adobe::any_regular_t>(
+               expression, main_branch, current_branch, input)
+        .cast<T>();
+}
+
+/****************************************************************************************************/
+
+template <>
+adobe::any_regular_t contextual_evaluation_of(const compiled_expression_t& expression,
+                                              inspection_branch_t          main_branch,
+                                              inspection_branch_t          current_branch,
+                                              bitreader_t&                 input);
+
+template <>
+inspection_branch_t contextual_evaluation_of(const compiled_expression_t& expression,
+                                             inspection_branch_t          main_branch,
+                                             inspection_branch_t          current_branch,
+                                             bitreader_t&                 input);
+
+/****************************************************************************************************/
+
 template <typename T>
 T finalize_lookup(inspection_branch_t root,
                   inspection_branch_t branch,
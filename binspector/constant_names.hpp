@@ -19,6 +19,7 @@ CONSTANT_KEY(enumerated_expression);
 CONSTANT_KEY(enumerated_option_expression);
 CONSTANT_KEY(die_expression);
 CONSTANT_KEY(field_conditional_type);
+CONSTANT_KEY(field_delimiter_alignment_expression);
 CONSTANT_KEY(field_if_expression);
 CONSTANT_KEY(field_name);
 CONSTANT_KEY(field_assign_expression);
@@ -10,9 +10,13 @@
 
 // stdc++
 #include <algorithm>
+#include <cassert>
+#include <cstring>
 
 // boost
+#include <boost/cstdint.hpp>
 #include <boost/endian.hpp>
+#include <boost/predef/other/endian.h>
 
 // asl
 
@@ -45,6 +49,58 @@ void host_to_endian(C& c, bool embiggen) {
         std::reverse(begin(c), end(c));
 }
 
+/****************************************************************************************************/
+
+template <typename T>
+inline T load_endian(const boost::uint8_t* p, bool embiggen) {
+    T x;
+
+    std::memcpy(&x, p, sizeof(T));
+
+    return embiggen ? boost::endian::big_to_native(x) : boost::endian::little_to_native(x);
+}
+
+/****************************************************************************************************/
+
+template <typename T>
+inline void store_endian(T x, boost::uint8_t* p, bool embiggen) {
+    x = embiggen ? boost::endian::native_to_big(x) : boost::endian::native_to_little(x);
+
+    std::memcpy(p, &x, sizeof(T));
+}
+
+/****************************************************************************************************/
+/*
+    Assembles up to eight bytes into an integer, interpreting them as big- or little-endian. The
+    power-of-two widths are loaded whole and byte swapped in a register; other sizes (e.g., 24-bit
+    fields) fall back to a shift loop. Either way the result is zero-extended.
+*/
+inline boost::uint64_t uint_from_bytes(const boost::uint8_t* p, std::size_t size, bool embiggen) {
+    assert(size <= sizeof(boost::uint64_t));
+
+    switch (size) {
+        case 1:
+            return *p;
+        case 2:
+            return load_endian<boost::uint16_t>(p, embiggen);
+        case 4:
+            return load_endian<boost::uint32_t>(p, embiggen);
+        case 8:
+            return load_endian<boost::uint64_t>(p, embiggen);
+    }
+
+    boost::uint64_t result(0);
+
+    if (embiggen)
+        for (std::size_t i(0); i < size; ++i)
+            result = result << 8 | p[i];
+    else
+        for (std::size_t i(size); i != 0; --i)
+            result = result << 8 | p[i - 1];
+
+    return result;
+}
+
 /****************************************************************************************************/
 // BINSPECTOR_ENDIAN_HPP
 #endif
@@ -0,0 +1,149 @@
+/*
+    Copyright 2014 Adobe
+    Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+/****************************************************************************************************/
+
+#ifndef BINSPECTOR_EXPRESSION_HPP
+#define BINSPECTOR_EXPRESSION_HPP
+
+// stdc++
+#include <vector>
+
+// boost
+#include <boost/cstdint.hpp>
+
+// asl
+#include <adobe/array.hpp>
+#include <adobe/name.hpp>
+
+/****************************************************************************************************/
+
+// The functions a template expression can call.
+enum builtin_function_t {
+    builtin_unknown_k = 0,
+    builtin_byte_k,
+    builtin_card_k,
+    builtin_endof_k,
+    builtin_fcc_k,
+    builtin_gtell_k,
+    builtin_indexof_k,
+    builtin_itoah_k,
+    builtin_itop_k,
+    builtin_padd_k,
+    builtin_path_k,
+    builtin_peek_k,
+    builtin_print_k,
+    builtin_psub_k,
+    builtin_ptoi_k,
+    builtin_sizeof_k,
+    builtin_startof_k,
+    builtin_str_k,
+    builtin_strcat_k,
+    builtin_summaryof_k,
+    builtin_utf16utf8_k,
+};
+
+builtin_function_t builtin_function_for(adobe::name_t name);
+
+/****************************************************************************************************/
+
+enum opcode_t {
+    op_push_k,        // push constants[operand]
+    op_main_k,        // push the main branch
+    op_this_k,        // push the current node
+    op_variable_k,    // push the field names[operand], looked up at or above the current node
+    op_subfield_k,    // replace the top with its subfield names[operand]
+    op_index_k,       // pop an index (number or name) and replace the top with that element of it
+    op_call_k,        // pop count arguments and push the result of builtin function operand
+    op_array_k,       // pop count values and push them as an array
+    op_add_k,         // the arithmetic and comparison ops pop two values and push one
+    op_subtract_k,
+    op_multiply_k,
+    op_divide_k,
+    op_modulus_k,
+    op_less_k,
+    op_greater_k,
+    op_less_equal_k,
+    op_greater_equal_k,
+    op_equal_k,
+    op_not_equal_k,
+    op_not_k,         // replace the top with its logical not
+    op_negate_k,      // replace the top with its arithmetic negation
+    op_and_k,         // if the top is false jump to operand, else pop it
+    op_or_k,          // if the top is true jump to operand, else pop it
+    op_jump_k,        // jump to operand
+    op_jump_unless_k, // pop the top and jump to operand if it is false
+};
+
+struct instruction_t {
+    opcode_t        opcode_m;
+    boost::uint32_t operand_m;
+    boost::uint32_t count_m;
+};
+
+/****************************************************************************************************/
+
+// A template expression lowered from the token stream the expression parser produces into
+// bytecode for the evaluation engine. Names are interned up front and built-in functions are
+// resolved to their index, so evaluation does no lookups by name beyond the fields themselves.
+//
+// Anything the bytecode does not cover (e.g., named argument lists) leaves the expression marked
+// as a fallback, and the engine interprets source() with the ASL virtual machine instead.
+//
+// Expressions made only of literals (e.g., `big`, `32`, `4096:`) are folded when compiled, and
+// callers can take constant_value() without evaluating anything.
+class compiled_expression_t {
+public:
+    // expression must outlive the compiled expression.
+    explicit compiled_expression_t(const adobe::array_t& expression);
+
+    const adobe::array_t& source() const {
+        return *source_m;
+    }
+
+    bool empty() const {
+        return source_m->empty();
+    }
+
+    bool fallback() const {
+        return fallback_m;
+    }
+
+    bool is_constant() const {
+        return constant_m;
+    }
+
+    // only meaningful when is_constant()
+    const adobe::any_regular_t& constant_value() const {
+        return constant_value_m;
+    }
+
+    const std::vector<instruction_t>& code() const {
+        return code_m;
+    }
+
+    const adobe::array_t& constants() const {
+        return constants_m;
+    }
+
+    const std::vector<adobe::name_t>& names() const {
+        return names_m;
+    }
+
+private:
+    const adobe::array_t*      source_m;
+    bool                       fallback_m;
+    bool                       constant_m;
+    adobe::any_regular_t       constant_value_m;
+    std::vector<instruction_t> code_m;
+    adobe::array_t             constants_m;
+    std::vector<adobe::name_t> names_m;
+};
+
+/****************************************************************************************************/
+// BINSPECTOR_EXPRESSION_HPP
+#endif
+
+/****************************************************************************************************/
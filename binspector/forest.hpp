@@ -8,11 +8,16 @@
 #ifndef BINSPECTOR_FOREST_HPP
 #define BINSPECTOR_FOREST_HPP
 
+// stdc++
+#include <memory>
+#include <vector>
+
 // boost
 #include <boost/cstdint.hpp>
 
 // asl
 #include <adobe/array.hpp>
+#include <adobe/closed_hash.hpp>
 #include <adobe/enum_ops.hpp>
 #include <adobe/forest.hpp>
 #include <adobe/name.hpp>
@@ -36,6 +41,12 @@ enum node_flags_t {
 
     /* atom flags */
     atom_is_big_endian_k = 1 << 7UL,
+
+    /* array flags */
+    is_implicit_array_k = 1 << 8UL,
+
+    /* struct flags */
+    is_summary_rendered_k = 1 << 9UL, // summary_m holds summary_expression_m's rendering
 };
 
 ADOBE_DEFINE_BITSET_OPS(node_flags_t);
@@ -64,11 +75,21 @@ enum atom_base_type_t {
 
 /****************************************************************************************************/
 
+struct child_index_t;   // defined once inspection_branch_t is
+struct element_table_t; // ditto
+struct expansion_t;     // ditto
+struct parent_link_t;   // ditto
+
+class compiled_expression_t; // see expression.hpp
+
+/****************************************************************************************************/
+
 struct node_t {
     node_t()
-        : flags_m(flags_none_k), type_m(atom_unknown_k), start_offset_m(invalid_position_k),
-          end_offset_m(invalid_position_k), cardinal_m(0), shuffle_m(false), bit_count_m(0),
-          use_count_m(0), evaluated_m(false), no_print_m(false) {}
+        : flags_m(flags_none_k), type_m(atom_unknown_k), summary_expression_m(nullptr),
+          start_offset_m(invalid_position_k), end_offset_m(invalid_position_k), cardinal_m(0),
+          shuffle_m(false), forest_m(nullptr), bit_count_m(0), use_count_m(0),
+          compiled_expression_m(nullptr), evaluated_m(false), no_print_m(false) {}
 
     void set_flag(node_flags_t flag, bool value = true) {
         enum_set(flags_m, flag, value);
@@ -82,6 +103,10 @@ struct node_t {
     atom_base_type_t type_m;
     adobe::name_t    name_m;
     std::string summary_m; // individual array elements have different summaries, that's the point.
+    const compiled_expression_t* summary_expression_m; // renders summary_m; see summary_of
+
+    std::shared_ptr<parent_link_t> parent_m; // see parent_of
+    std::shared_ptr<parent_link_t> link_m;   // this node, as its children's parent_m
 
     /* struct or array root fields */
     inspection_position_t start_offset_m;
@@ -91,19 +116,27 @@ struct node_t {
     boost::uint64_t cardinal_m; // size for array root; index for array element
     bool            shuffle_m;  // let hairbrain shuffle these array elements around
 
+    std::shared_ptr<element_table_t> element_table_m; // array roots only; see find_element
+
+    /* implicit array root fields */
+    adobe::forest<node_t>* forest_m; // owner of the root; elements are materialized into it
+
     /* atom fields */
     boost::uint64_t       bit_count_m;
     inspection_position_t location_m;  // atom's location in the binary file
     std::size_t           use_count_m; // incremented at each call to fetch_and_evaluate
 
-    /* const and slot fields */
-    adobe::array_t       expression_m;
-    bool                 evaluated_m; // we do lazy evaluation; cache the result and flag
-    adobe::any_regular_t evaluated_value_m;
-    bool                 no_print_m; // don't print this constant during output
+    /* const and slot fields (atoms use the cache, too) */
+    adobe::array_t               expression_m;          // for display
+    const compiled_expression_t* compiled_expression_m; // what is evaluated; see declared_value_of
+    bool                         evaluated_m; // we do lazy evaluation; cache the result and flag
+    adobe::any_regular_t         evaluated_value_m;
+    bool                         no_print_m; // don't print this constant during output
 
     /* struct fields */
-    adobe::name_t struct_name_m;
+    adobe::name_t                  struct_name_m;
+    std::shared_ptr<child_index_t> child_index_m; // see index_child
+    std::shared_ptr<expansion_t>   expansion_m;   // what is left to analyze; see expand_node
 
     /* enumerated fields */
     adobe::array_t option_set_m;
@@ -150,11 +183,139 @@ typedef adobe::depth_fullorder_iterator<boost::range_iterator<inspection_forest_
                                            depth_full_iterator_t;
 typedef std::unique_ptr<inspection_forest_t> auto_forest_t;
 
+// The first child of a node by each name, so resolving an identifier costs a probe per scope
+// instead of a scan of every sibling.
+struct child_index_t : adobe::closed_hash_map<adobe::name_t, inspection_branch_t> {};
+
+// An array root's element nodes by index, so indexing into an array need not walk its children.
+struct element_table_t : adobe::closed_hash_map<boost::uint64_t, inspection_branch_t> {};
+
+// A node's children share a link to it, so finding the parent need not walk the siblings.
+struct parent_link_t {
+    inspection_branch_t branch_m;
+};
+
+// The part of a node's analysis left until something first looks inside the node, e.g., a
+// sentry's body (see binspector_analyzer_t::set_lazy).
+struct expansion_t {
+    virtual ~expansion_t() {}
+
+    virtual void expand(inspection_branch_t branch) = 0;
+};
+
+/****************************************************************************************************/
+// Nodes are linked to their parent as they are added to it; adobe::find_parent, which walks to the
+// end of the siblings, is only the fallback for nodes that were not.
+inline void link_child(inspection_branch_t parent, inspection_branch_t child) {
+    if (!parent->link_m) {
+        parent.edge() = adobe::forest_leading_edge;
+
+        parent->link_m = std::make_shared<parent_link_t>(parent_link_t{parent});
+    }
+
+    child->parent_m = parent->link_m;
+}
+
+inline inspection_branch_t parent_of(inspection_branch_t branch) {
+    return branch->parent_m ? branch->parent_m->branch_m : adobe::find_parent(branch);
+}
+
+inline const_inspection_branch_t parent_of(const_inspection_branch_t branch) {
+    return branch->parent_m ? const_inspection_branch_t(branch->parent_m->branch_m) :
+                              adobe::find_parent(branch);
+}
+
 template <typename T>
 struct node_member {
     typedef T (node_t::*value)() const;
 };
 
+/****************************************************************************************************/
+// Named children are indexed as they are added to their parent, and must be unindexed before they
+// are erased. Lookups only see indexed children.
+inline void index_child(inspection_branch_t parent, inspection_branch_t child) {
+    if (!child->name_m)
+        return;
+
+    if (!parent->child_index_m)
+        parent->child_index_m = std::make_shared<child_index_t>();
+
+    // the first child by a name wins, as it would in a scan.
+    parent->child_index_m->insert(child_index_t::value_type(child->name_m, child));
+}
+
+inline void unindex_child(inspection_branch_t parent, inspection_branch_t child) {
+    if (!child->name_m || !parent->child_index_m)
+        return;
+
+    child_index_t::iterator found(parent->child_index_m->find(child->name_m));
+
+    if (found != parent->child_index_m->end() && found->second.equal_node(child))
+        parent->child_index_m->erase(found);
+}
+
+inline inspection_branch_t find_child(const_inspection_branch_t parent, adobe::name_t name) {
+    if (!parent->child_index_m)
+        return inspection_branch_t();
+
+    child_index_t::const_iterator found(parent->child_index_m->find(name));
+
+    return found == parent->child_index_m->end() ? inspection_branch_t() : found->second;
+}
+
+/****************************************************************************************************/
+// Finishes the analysis of a node left unexpanded. Returns false if there was nothing left to do.
+inline bool expand_node(inspection_branch_t branch) {
+    if (!branch->expansion_m)
+        return false;
+
+    // taken first, so nothing the expansion looks up in the node expands it again.
+    std::shared_ptr<expansion_t> expansion(std::move(branch->expansion_m));
+
+    expansion->expand(branch);
+
+    return true;
+}
+
+// Expands every node under branch, including the ones expanding adds, e.g., to print them all.
+inline void expand_subtree(inspection_branch_t branch) {
+    std::vector<inspection_branch_t> pending(1, branch);
+
+    while (!pending.empty()) {
+        inspection_branch_t node(pending.back());
+
+        pending.pop_back();
+
+        expand_node(node);
+
+        for (inspection_forest_t::child_iterator iter(adobe::child_begin(node)),
+             last(adobe::child_end(node));
+             iter != last;
+             ++iter)
+            pending.push_back(iter.base());
+    }
+}
+
+/****************************************************************************************************/
+// Array elements are tabled by index as they are added to their root: every element of an
+// explicit array, and the elements of an implicit array as they are materialized. Roots without a
+// table (e.g., empty arrays) have no elements to find.
+inline void table_element(inspection_branch_t root, inspection_branch_t element) {
+    if (!root->element_table_m)
+        root->element_table_m = std::make_shared<element_table_t>();
+
+    (*root->element_table_m)[element->cardinal_m] = element;
+}
+
+inline inspection_branch_t find_element(const_inspection_branch_t root, boost::uint64_t index) {
+    if (!root->element_table_m)
+        return inspection_branch_t();
+
+    element_table_t::const_iterator found(root->element_table_m->find(index));
+
+    return found == root->element_table_m->end() ? inspection_branch_t() : found->second;
+}
+
 /****************************************************************************************************/
 // A property is something generic to the node's type, like structure name or endianness.
 // If the node is an array element we get the property from the parent, otherwise itself.
@@ -164,7 +325,7 @@ T node_property(const_inspection_branch_t branch, T (node_t::*member_function)()
     bool                 is_array_element(node.get_flag(is_array_element_k));
 
     if (is_array_element)
-        return node_property<T>(adobe::find_parent(branch), member_function);
+        return node_property<T>(parent_of(branch), member_function);
 
     return (node.*member_function)();
 }
@@ -175,7 +336,7 @@ T node_property(const_inspection_branch_t branch, T node_t::*member) {
     bool                 is_array_element(node.get_flag(is_array_element_k));
 
     if (is_array_element)
-        return node_property<T>(adobe::find_parent(branch), member);
+        return node_property<T>(parent_of(branch), member);
 
     return node.*member;
 }
@@ -185,23 +346,24 @@ inline bool node_property(const_inspection_branch_t branch, node_flags_t flag) {
     bool                 is_array_element(node.get_flag(is_array_element_k));
 
     if (is_array_element)
-        return node_property(adobe::find_parent(branch), flag);
+        return node_property(parent_of(branch), flag);
 
     return node.get_flag(flag);
 }
 
 inline const_inspection_branch_t property_node_for(const_inspection_branch_t branch) {
-    return branch->get_flag(is_array_element_k) ? property_node_for(adobe::find_parent(branch)) :
-                                                  branch;
+    return branch->get_flag(is_array_element_k) ? property_node_for(parent_of(branch)) : branch;
 }
 
 /****************************************************************************************************/
 // A value is something specific to this node, like location or name.
 // If the node is an array root, we get the value from the first child, otherwise itself.
+// Implicit array roots hold the first element's location themselves.
 template <typename T>
 T node_value(const_inspection_branch_t branch, T (node_t::*member_function)() const) {
     const forest_node_t& node(*branch);
-    bool                 is_array_root(node.get_flag(is_array_root_k));
+    bool                 is_array_root(node.get_flag(is_array_root_k) &&
+                                       !node.get_flag(is_implicit_array_k));
 
     if (is_array_root) {
         inspection_forest_t::const_child_iterator first_child(adobe::child_begin(branch));
@@ -217,7 +379,8 @@ T node_value(const_inspection_branch_t branch, T (node_t::*member_function)() co
 template <typename T>
 T node_value(const_inspection_branch_t branch, T node_t::*member) {
     const forest_node_t& node(*branch);
-    bool                 is_array_root(node.get_flag(is_array_root_k));
+    bool                 is_array_root(node.get_flag(is_array_root_k) &&
+                                       !node.get_flag(is_implicit_array_k));
 
     if (is_array_root) {
         inspection_forest_t::const_child_iterator first_child(adobe::child_begin(branch));
@@ -230,6 +393,73 @@ T node_value(const_inspection_branch_t branch, T node_t::*member) {
     return node.*member;
 }
 
+/****************************************************************************************************/
+// Atom arrays are implicit: rather than a node per element, the root holds the location of the
+// first element (location_m), the element stride (bit_count_m) and the element count
+// (cardinal_m). A node is only materialized for an element when it is asked for by index;
+// materialized elements are kept among the root's children in the order they were asked for, and
+// tabled by index.
+inline inspection_position_t array_element_location(const_inspection_branch_t root,
+                                                    boost::uint64_t           index) {
+    return root->location_m + bitpos(root->bit_count_m * index);
+}
+
+inline inspection_branch_t array_element(inspection_branch_t root, boost::uint64_t index) {
+    inspection_branch_t found(find_element(root, index));
+
+    if (!found.equal_node(inspection_branch_t()))
+        return found;
+
+    forest_node_t element;
+
+    element.set_flag(is_array_element_k);
+    element.cardinal_m = index;
+    element.location_m = array_element_location(root, index);
+
+    inspection_branch_t result(root->forest_m->insert(adobe::trailing_of(root), element));
+
+    link_child(root, result);
+    table_element(root, result);
+
+    return result;
+}
+
+// Visits every element of an implicit array in order. Elements that have not been materialized
+// are visited through one transient node, reused for all of them. It is kept in a forest of its
+// own, so the one the caller may be walking is left as it is; only its parent link (see parent_of)
+// ties it to the array.
+template <typename F>
+void for_each_array_element(inspection_branch_t root, F f) {
+    inspection_forest_t detached;
+    inspection_branch_t transient;
+
+    for (boost::uint64_t i(0); i < root->cardinal_m; ++i) {
+        inspection_branch_t materialized(find_element(root, i));
+
+        if (!materialized.equal_node(inspection_branch_t())) {
+            f(materialized);
+
+            continue;
+        }
+
+        if (transient.equal_node(inspection_branch_t())) {
+            forest_node_t element;
+
+            element.set_flag(is_array_element_k);
+
+            transient = detached.insert(detached.end(), element);
+
+            link_child(root, transient);
+        }
+
+        transient->cardinal_m  = i;
+        transient->location_m  = array_element_location(root, i);
+        transient->evaluated_m = false;
+
+        f(transient);
+    }
+}
+
 /****************************************************************************************************/
 // BINSPECTOR_FOREST_HPP
 #endif
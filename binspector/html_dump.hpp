@@ -12,16 +12,19 @@
 #include <iostream>
 #include <string>
 
+// boost
+#include <boost/filesystem.hpp>
+
 // application
 #include <binspector/common.hpp>
 
 /****************************************************************************************************/
 
-void binspector_html_dump(std::istream&      input,
-                          auto_forest_t      aforest,
-                          std::ostream&      output,
-                          const std::string& coutput,
-                          const std::string& cerrput);
+void binspector_html_dump(const boost::filesystem::path& input_path,
+                          auto_forest_t                  aforest,
+                          std::ostream&                  output,
+                          const std::string&             coutput,
+                          const std::string&             cerrput);
 
 /****************************************************************************************************/
 // BINSPECTOR_HTML_DUMP
@@ -13,6 +13,9 @@
 #include <map>
 #include <stdexcept>
 
+// boost
+#include <boost/filesystem.hpp>
+
 // application
 #include <binspector/common.hpp>
 
@@ -30,7 +33,9 @@ struct linenoiseCompletions;
 
 class binspector_interface_t {
 public:
-    binspector_interface_t(std::istream& binary_file, auto_forest_t forest, std::ostream& output);
+    binspector_interface_t(const boost::filesystem::path& binary_path,
+                           auto_forest_t                  forest,
+                           std::ostream&                  output);
 
     void command_line();
 
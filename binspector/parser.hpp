@@ -57,7 +57,8 @@
     invariant          = "invariant" identifier '=' expression
     constant           = [ "const" | "invis" ] identifier '=' expression { "noprint" }
     skip               = "skip" identifier '[' expression ']'
-    field_size         = '[' { [ "while" | "terminator" | "delimiter" ] ':' } expression ']' { "shuffle" }
+    field_size         = '[' { [ "while" | "terminator" | "delimiter" ] ':' } expression { alignment } ']' { "shuffle" }
+    alignment          = ',' "align" ':' expression    // "align" is not reserved elsewhere
     slot               = "slot" identifier '=' expression
     signal             = "signal" identifier '=' expression
     field              = field_type identifier { field_size } { offset }
@@ -130,6 +131,7 @@ private:
     bool is_skip();
     bool is_field_size(field_size_t&   field_size_type,
                        adobe::array_t& field_size_expression,
+                       adobe::array_t& alignment_expression,
                        bool&           shuffleable);
     bool is_slot();
     bool is_signal();
@@ -73,8 +73,64 @@ fi
 echo_run $BINPATH -t ./test/issue1.bfft -i ./test/empty.bin -m validate
 echo_run $BINPATH -t ./test/issue11.bfft -i $JPEGPATH -m validate
 echo_run $BINPATH -t ./test/issue19.bfft -i ./test/empty.bin -m validate
+echo_run $BINPATH -t ./test/bitfields.bfft -i $JPEGPATH -m validate
+echo_run $BINPATH -t ./test/delimiter.bfft -i $JPEGPATH -m validate
+echo_run $BINPATH -t ./test/delimiter_align.bfft -i ./test/delimiter.bin -m validate
+echo_run $BINPATH -t ./test/atom_array.bfft -i $JPEGPATH -m validate
+echo_run $BINPATH -t ./test/struct_array.bfft -i $JPEGPATH -m validate
+echo_run $BINPATH -t ./test/deep_nesting.bfft -i $JPEGPATH -m validate
+echo_run $BINPATH -t ./test/length_prefixed.bfft -i $JPEGPATH -m validate
+echo_run $BINPATH -t ./test/length_prefixed.bfft -i $JPEGPATH -m validate --parallel
+echo_run $BINPATH -t ./test/length_prefixed.bfft -i $JPEGPATH -m cli <<< $'print_branch\nquit'
 echo_run $BINPATH -t ./bfft/png.bfft -i $PNGPATH -m validate
+echo_run $BINPATH -t ./bfft/png.bfft -i $PNGPATH -m validate --parallel
 echo_run $BINPATH -t ./bfft/jpg.bfft -i $JPEGPATH -m validate
+
+# Validation skips reading what nothing looks up, but has to fail wherever a full analysis does.
+echo "EXEC : $BINPATH -t ./test/byte_order.bfft -i $JPEGPATH -m validate (expected to fail)"
+
+if $BINPATH -t ./test/byte_order.bfft -i $JPEGPATH -m validate > /dev/null 2>&1 ; then
+    echo "ERROR : validation accepted an atom whose byte order cannot be evaluated"
+    exit 1
+fi
+
+# A reanalysis of an edit has to say what an analysis of the edited file does.
+ZEROSPATH='samples/zeros_16.bin'
+EDITEDPATH='samples/zeros_16_edited.bin'
+
+head -c 16 /dev/zero > $ZEROSPATH
+cp $ZEROSPATH $EDITEDPATH
+printf '\x2a' | dd of=$EDITEDPATH bs=1 seek=12 conv=notrunc 2> /dev/null
+
+echo "EXEC : $BINPATH -t ./test/reanalyze.bfft -i $ZEROSPATH --reanalyze $EDITEDPATH -m validate"
+FRESH=`$BINPATH -t ./test/reanalyze.bfft -i $EDITEDPATH -m validate` || exit 1
+REANALYZED=`$BINPATH -t ./test/reanalyze.bfft -i $ZEROSPATH --reanalyze $EDITEDPATH -m validate` || exit 1
+
+if [ "$FRESH" != "$REANALYZED" ]; then
+    echo "ERROR : reanalysis of $EDITEDPATH differs from its analysis"
+    exit 1
+fi
+
+# Validation forgets what nothing can look up any more, so a long array takes a bounded forest.
+LONGPATH='samples/zeros_65536.bin'
+
+head -c 65536 /dev/zero > $LONGPATH
+
+for STRUCT in counted indexed ; do
+    ARGS="-t ./test/streaming.bfft -i $LONGPATH -m validate --node-stats -s $STRUCT"
+
+    echo "EXEC : $BINPATH $ARGS"
+    STATS=`$BINPATH $ARGS 2>&1 > /dev/null` || exit 1
+    PEAK=`echo "$STATS" | sed -n 's/^Forest: at most \([0-9]*\) nodes at once$/\1/p'`
+
+    # one node per box is all the indexed boxes may keep
+    if [ "$STRUCT" == "counted" ] ; then LIMIT=64 ; else LIMIT=131072 ; fi
+
+    if [ -z "$PEAK" ] || [ $PEAK -gt $LIMIT ] ; then
+        echo "ERROR : validating $STRUCT held ${PEAK:-unknown} nodes at once (at most $LIMIT)"
+        exit 1
+    fi
+done
 echo_run $BINPATH -t ./bfft/png.bfft -i $PNGPATH -m fuzz --fuzz-recurse
 echo_run $BINPATH -t ./bfft/png.bfft -i $PNGPATH -m fuzz
 echo_run $BINPATH -t ./bfft/jpg.bfft -i $JPEGPATH -m fuzz --fuzz-recurse
@@ -8,12 +8,25 @@
 // identity
 #include <binspector/analyzer.hpp>
 
+// stdc++
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <thread>
+
 // asl
 #include <adobe/algorithm/copy.hpp>
 #include <adobe/dictionary_set.hpp>
 #include <adobe/implementation/token.hpp>
 #include <adobe/string.hpp>
 
+// stlab
+#include <stlab/concurrency/default_executor.hpp>
+#include <stlab/concurrency/utility.hpp>
+
+// application
+#include <binspector/endian.hpp>
+
 /****************************************************************************************************/
 
 namespace {
@@ -119,6 +132,487 @@ std::size_t highest_byte_for(boost::uint64_t value) {
 
 /****************************************************************************************************/
 
+typedef binspector_analyzer_t::field_descriptor_t field_descriptor_t;
+
+/****************************************************************************************************/
+// Whether an expression can be evaluated with nothing above the array element it is in. Names
+// are looked up from the element up, so one it does not find is an error there anyway; main, and
+// the functions that take it as their root, are what the element would quietly get wrong.
+bool is_local(const compiled_expression_t& expression) {
+    if (expression.fallback())
+        return false;
+
+    for (const auto& instruction : expression.code()) {
+        if (instruction.opcode_m == op_main_k)
+            return false;
+
+        if (instruction.opcode_m == op_call_k && (instruction.operand_m == builtin_path_k ||
+                                                  instruction.operand_m == builtin_summaryof_k))
+            return false;
+    }
+
+    return true;
+}
+
+/****************************************************************************************************/
+// Holds back whatever is written to a stream during its lifetime.
+struct stream_hold_t {
+    explicit stream_hold_t(std::ostream& stream)
+        : stream_m(stream), saved_m(stream.rdbuf(held_m.rdbuf())) {}
+
+    ~stream_hold_t() {
+        stream_m.rdbuf(saved_m);
+    }
+
+    bool empty() {
+        return held_m.tellp() <= 0;
+    }
+
+    std::ostream&     stream_m;
+    std::stringstream held_m;
+    std::streambuf*   saved_m;
+};
+
+/****************************************************************************************************/
+// Sends whatever is written to a stream during its lifetime to another one instead.
+struct stream_redirect_t {
+    stream_redirect_t(std::ostream& stream, std::ostream& to)
+        : stream_m(stream), saved_m(stream.rdbuf(to.rdbuf())) {}
+
+    ~stream_redirect_t() {
+        stream_m.rdbuf(saved_m);
+    }
+
+    std::ostream&   stream_m;
+    std::streambuf* saved_m;
+};
+
+/****************************************************************************************************/
+// Gives an analyzer back the forest it handed off (see binspector_analyzer_t::forest) for as long
+// as the loan lives.
+struct forest_loan_t {
+    forest_loan_t(auto_forest_t& owner, inspection_forest_t* forest)
+        : owner_m(owner), lent_m(!owner) {
+        if (lent_m)
+            owner_m.reset(forest);
+    }
+
+    ~forest_loan_t() {
+        if (lent_m)
+            owner_m.release();
+    }
+
+    auto_forest_t& owner_m;
+    bool           lent_m;
+};
+
+/****************************************************************************************************/
+// The fields that can be analyzed ahead of a sentry's body: they add at most one node to the
+// structure they are in, and push no structure of their own. (Named fields also have to resolve to
+// an atom; that is only known once they are reached.)
+bool is_framing_field(const field_descriptor_t& field) {
+    if (field.conditional_m != none_k)
+        return false;
+
+    switch (field.kind_m) {
+        case binspector_analyzer_t::field_kind_atom_k:
+        case binspector_analyzer_t::field_kind_const_k:
+        case binspector_analyzer_t::field_kind_invariant_k:
+        case binspector_analyzer_t::field_kind_named_k:
+        case binspector_analyzer_t::field_kind_skip_k:
+        case binspector_analyzer_t::field_kind_slot_k:
+        case binspector_analyzer_t::field_kind_summary_k:
+        case binspector_analyzer_t::field_kind_typedef_atom_k:
+        case binspector_analyzer_t::field_kind_typedef_named_k:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/****************************************************************************************************/
+// The names of the nodes a structure adds to the node it is analyzed into, including those of the
+// blocks (e.g., enumerate options) that add theirs to the same node.
+std::vector<adobe::name_t> flattened_names(
+    const binspector_analyzer_t::compiled_structure_t& structure) {
+    std::vector<adobe::name_t>                                      result;
+    std::vector<const binspector_analyzer_t::compiled_structure_t*> blocks(1, &structure);
+
+    while (!blocks.empty()) {
+        const binspector_analyzer_t::compiled_structure_t& block(*blocks.back());
+
+        blocks.pop_back();
+
+        for (const auto& field : block) {
+            bool flattened(field.conditional_m != none_k ||
+                           field.kind_m == binspector_analyzer_t::field_kind_enumerated_k ||
+                           field.kind_m == binspector_analyzer_t::field_kind_enumerated_option_k ||
+                           field.kind_m == binspector_analyzer_t::field_kind_enumerated_default_k ||
+                           field.kind_m == binspector_analyzer_t::field_kind_sentry_k);
+
+            if (flattened) {
+                if (field.structure_m)
+                    blocks.push_back(field.structure_m);
+            } else if (field.kind_m == binspector_analyzer_t::field_kind_atom_k ||
+                       field.kind_m == binspector_analyzer_t::field_kind_const_k ||
+                       field.kind_m == binspector_analyzer_t::field_kind_named_k ||
+                       field.kind_m == binspector_analyzer_t::field_kind_skip_k ||
+                       field.kind_m == binspector_analyzer_t::field_kind_slot_k ||
+                       field.kind_m == binspector_analyzer_t::field_kind_struct_k) {
+                result.push_back(field.name_m);
+            }
+        }
+    }
+
+    return result;
+}
+
+/****************************************************************************************************/
+// Whether any of a field's expressions looks up one of names, or might.
+bool uses_any(const field_descriptor_t& field, const std::vector<adobe::name_t>& names) {
+    const compiled_expression_t* expressions[] = {field.expression_m,
+                                                  field.size_expression_m,
+                                                  field.offset_expression_m,
+                                                  field.alignment_expression_m,
+                                                  field.bit_count_expression_m,
+                                                  field.is_big_endian_expression_m};
+
+    for (const compiled_expression_t* expression : expressions) {
+        if (expression->fallback())
+            return true;
+
+        for (const auto& instruction : expression->code())
+            if (instruction.opcode_m == op_variable_k &&
+                std::find(names.begin(),
+                          names.end(),
+                          expression->names()[instruction.operand_m]) != names.end())
+                return true;
+    }
+
+    return false;
+}
+
+/****************************************************************************************************/
+// Adds the names an expression could look fields up by to names. Returns whether it could also
+// look up the field it belongs to: through this, or a function that defaults to it.
+bool add_names(const compiled_expression_t& expression, std::set<adobe::name_t>& names) {
+    bool self(expression.fallback());
+
+    names.insert(expression.names().begin(), expression.names().end());
+
+    // e.g., card(@segment)
+    for (const auto& constant : expression.constants()) {
+        if (constant.type_info() != typeid(adobe::name_t))
+            continue;
+
+        adobe::name_t name(constant.cast<adobe::name_t>());
+
+        if (name == value_this)
+            self = true;
+        else
+            names.insert(name);
+    }
+
+    for (const auto& instruction : expression.code())
+        if (instruction.opcode_m == op_this_k ||
+            (instruction.opcode_m == op_call_k && instruction.count_m == 0))
+            self = true;
+
+    return self;
+}
+
+/****************************************************************************************************/
+// Adds the names an expression looks up as fields of another field (e.g., b in a.b or a[0].b) to
+// names. Those can be found from anywhere; a bare name is only found at or above where it is used.
+void add_subfield_names(const compiled_expression_t& expression, std::set<adobe::name_t>& names) {
+    for (const auto& instruction : expression.code())
+        if (instruction.opcode_m == op_subfield_k)
+            names.insert(expression.names()[instruction.operand_m]);
+}
+
+/****************************************************************************************************/
+// Adds the names an expression could look an array's elements up by to names: all of them but those
+// only ever passed alone to a function that needs no more than the array's root, e.g., card(@a).
+void add_element_names(const compiled_expression_t& expression, std::set<adobe::name_t>& names) {
+    const std::vector<instruction_t>& code(expression.code());
+
+    names.insert(expression.names().begin(), expression.names().end());
+
+    for (std::size_t pc(0); pc != code.size(); ++pc) {
+        if (code[pc].opcode_m != op_push_k)
+            continue;
+
+        const adobe::any_regular_t& constant(expression.constants()[code[pc].operand_m]);
+
+        if (constant.type_info() != typeid(adobe::name_t))
+            continue;
+
+        const instruction_t* next(pc + 1 != code.size() ? &code[pc + 1] : 0);
+
+        bool root_only(next && next->opcode_m == op_call_k && next->count_m == 1 &&
+                       (next->operand_m == builtin_card_k || next->operand_m == builtin_sizeof_k ||
+                        next->operand_m == builtin_startof_k ||
+                        next->operand_m == builtin_endof_k));
+
+        if (!root_only)
+            names.insert(constant.cast<adobe::name_t>());
+    }
+}
+
+/****************************************************************************************************/
+// Whether every name an expression could look a field up by is already a child of node, so it is
+// found there however much is analyzed after.
+bool names_found_in(const compiled_expression_t& expression, inspection_branch_t node) {
+    std::set<adobe::name_t> names;
+
+    add_names(expression, names);
+
+    for (adobe::name_t name : names)
+        if (find_child(node, name).equal_node(inspection_branch_t()))
+            return false;
+
+    return true;
+}
+
+/****************************************************************************************************/
+// A copy of a node to go into another forest: its links into this one are left behind.
+forest_node_t detached_copy(const forest_node_t& node, inspection_forest_t& forest) {
+    forest_node_t result(node);
+
+    result.parent_m.reset();
+    result.link_m.reset();
+    result.child_index_m.reset();
+    result.element_table_m.reset(); // implicit array elements are materialized again as needed
+    result.expansion_m.reset();
+
+    if (result.forest_m)
+        result.forest_m = &forest;
+
+    return result;
+}
+
+/****************************************************************************************************/
+// Appends a copy of node to parent's children, linked and indexed as new_branch would.
+inspection_branch_t append_copy(inspection_forest_t& forest,
+                                inspection_branch_t  parent,
+                                const forest_node_t& node) {
+    inspection_branch_t position(parent);
+
+    position.edge() = adobe::forest_trailing_edge;
+
+    inspection_branch_t result(forest.insert(position, detached_copy(node, forest)));
+
+    link_child(parent, result);
+    index_child(parent, result);
+
+    return result;
+}
+
+/****************************************************************************************************/
+// The last of a node's children, or a null branch if it has none.
+inspection_branch_t last_child_of(inspection_branch_t branch) {
+    if (!adobe::has_children(branch))
+        return inspection_branch_t();
+
+    return std::prev(adobe::child_end(branch)).base();
+}
+
+/****************************************************************************************************/
+// Indexes a node's children afresh, so the first of them by each name is the one found.
+void reindex_children(inspection_branch_t branch) {
+    branch->child_index_m.reset();
+
+    for (inspection_forest_t::child_iterator iter(adobe::child_begin(branch)),
+         last(adobe::child_end(branch));
+         iter != last;
+         ++iter)
+        index_child(branch, iter.base());
+}
+
+/****************************************************************************************************/
+// Erases the children of branch after last (all of them if last is null), unindexing and untabling
+// them as it goes.
+void erase_children_after(inspection_forest_t& forest,
+                          inspection_branch_t  branch,
+                          inspection_branch_t  last) {
+    for (inspection_branch_t child(last_child_of(branch)); !child.equal_node(last);
+         child = last_child_of(branch)) {
+        unindex_child(branch, child);
+
+        if (child->get_flag(is_array_element_k) && branch->element_table_m) {
+            element_table_t::iterator found(branch->element_table_m->find(child->cardinal_m));
+
+            if (found != branch->element_table_m->end() && found->second.equal_node(child))
+                branch->element_table_m->erase(found);
+        }
+
+        forest.erase(child);
+    }
+}
+
+/****************************************************************************************************/
+
+binspector_analyzer_t::field_kind_t field_kind_for(adobe::name_t type) {
+    if (type == value_field_type_atom)
+        return binspector_analyzer_t::field_kind_atom_k;
+    else if (type == value_field_type_const)
+        return binspector_analyzer_t::field_kind_const_k;
+    else if (type == value_field_type_die)
+        return binspector_analyzer_t::field_kind_die_k;
+    else if (type == value_field_type_enumerated)
+        return binspector_analyzer_t::field_kind_enumerated_k;
+    else if (type == value_field_type_enumerated_option)
+        return binspector_analyzer_t::field_kind_enumerated_option_k;
+    else if (type == value_field_type_enumerated_default)
+        return binspector_analyzer_t::field_kind_enumerated_default_k;
+    else if (type == value_field_type_invariant)
+        return binspector_analyzer_t::field_kind_invariant_k;
+    else if (type == value_field_type_named)
+        return binspector_analyzer_t::field_kind_named_k;
+    else if (type == value_field_type_notify)
+        return binspector_analyzer_t::field_kind_notify_k;
+    else if (type == value_field_type_sentry)
+        return binspector_analyzer_t::field_kind_sentry_k;
+    else if (type == value_field_type_signal)
+        return binspector_analyzer_t::field_kind_signal_k;
+    else if (type == value_field_type_skip)
+        return binspector_analyzer_t::field_kind_skip_k;
+    else if (type == value_field_type_slot)
+        return binspector_analyzer_t::field_kind_slot_k;
+    else if (type == value_field_type_struct)
+        return binspector_analyzer_t::field_kind_struct_k;
+    else if (type == value_field_type_summary)
+        return binspector_analyzer_t::field_kind_summary_k;
+    else if (type == value_field_type_typedef_atom)
+        return binspector_analyzer_t::field_kind_typedef_atom_k;
+    else if (type == value_field_type_typedef_named)
+        return binspector_analyzer_t::field_kind_typedef_named_k;
+
+    throw std::runtime_error(adobe::make_string("analysis error: unknown type: ", type.c_str()));
+}
+
+/****************************************************************************************************/
+// The key of the one expression a field of the given kind is driven by, if any.
+adobe::name_t expression_key_for(binspector_analyzer_t::field_kind_t kind,
+                                 conditional_expression_t            conditional) {
+    if (conditional != none_k)
+        return key_field_if_expression;
+
+    switch (kind) {
+        case binspector_analyzer_t::field_kind_const_k:
+            return key_const_expression;
+        case binspector_analyzer_t::field_kind_die_k:
+            return key_die_expression;
+        case binspector_analyzer_t::field_kind_enumerated_k:
+            return key_enumerated_expression;
+        case binspector_analyzer_t::field_kind_enumerated_option_k:
+            return key_enumerated_option_expression;
+        case binspector_analyzer_t::field_kind_invariant_k:
+        case binspector_analyzer_t::field_kind_signal_k:
+        case binspector_analyzer_t::field_kind_slot_k:
+            return key_field_assign_expression;
+        case binspector_analyzer_t::field_kind_notify_k:
+            return key_notify_expression;
+        case binspector_analyzer_t::field_kind_sentry_k:
+            return key_sentry_expression;
+        case binspector_analyzer_t::field_kind_skip_k:
+            return key_skip_expression;
+        case binspector_analyzer_t::field_kind_summary_k:
+            return key_summary_expression;
+        default:
+            return adobe::name_t();
+    }
+}
+
+/****************************************************************************************************/
+
+const compiled_expression_t* compile_expression(const adobe::array_t&                    expression,
+                                                binspector_analyzer_t::expression_pool_t& pool) {
+    static const adobe::array_t        empty_array_k;
+    static const compiled_expression_t empty_expression_k(empty_array_k);
+
+    if (expression.empty())
+        return &empty_expression_k;
+
+    pool.push_back(compiled_expression_t(expression));
+
+    return &pool.back();
+}
+
+/****************************************************************************************************/
+
+field_descriptor_t compile_field(
+    const adobe::dictionary_t&                             field,
+    const binspector_analyzer_t::compiled_structure_map_t& structure_map,
+    binspector_analyzer_t::expression_pool_t&              pool) {
+    static const adobe::array_t empty_array_k;
+    static const std::string    empty_string_k;
+
+    field_descriptor_t result;
+
+    result.kind_m        = field_kind_for(value_for<adobe::name_t>(field, key_field_type));
+    result.name_m        = value_for<adobe::name_t>(field, key_field_name, adobe::name_t());
+    result.type_name_m   = value_for<adobe::name_t>(field, key_named_type_name, adobe::name_t());
+    result.structure_m   = 0;
+    result.conditional_m = value_for<conditional_expression_t>(field,
+                                                               key_field_conditional_type,
+                                                               conditional_expression_t(none_k));
+    result.size_type_m =
+        value_for<field_size_t>(field, key_field_size_type, field_size_t(field_size_none_k));
+    result.base_type_m =
+        value_for<atom_base_type_t>(field, key_atom_base_type, atom_base_type_t(atom_unknown_k));
+    result.shuffle_m  = value_for<bool>(field, key_field_shuffle, false);
+    result.no_print_m = value_for<bool>(field, key_const_no_print, false);
+
+    adobe::name_t expression_key(expression_key_for(result.kind_m, result.conditional_m));
+
+    result.expression_m = compile_expression(
+        expression_key ? value_for<adobe::array_t>(field, expression_key) : empty_array_k, pool);
+    result.size_expression_m = compile_expression(
+        value_for<adobe::array_t>(field, key_field_size_expression, empty_array_k), pool);
+    result.offset_expression_m = compile_expression(
+        value_for<adobe::array_t>(field, key_field_offset_expression, empty_array_k), pool);
+    result.alignment_expression_m = compile_expression(
+        value_for<adobe::array_t>(field, key_field_delimiter_alignment_expression, empty_array_k),
+        pool);
+    result.bit_count_expression_m = compile_expression(
+        value_for<adobe::array_t>(field, key_atom_bit_count_expression, empty_array_k), pool);
+    result.is_big_endian_expression_m = compile_expression(
+        value_for<adobe::array_t>(field, key_atom_is_big_endian_expression, empty_array_k), pool);
+    result.enumeration_m = 0;
+
+    result.filename_m = adobe::name_t(
+        value_for<std::string>(field, key_parse_info_filename, empty_string_k).c_str());
+    result.line_number_m = static_cast<boost::uint32_t>(
+        value_for<double>(field, key_parse_info_line_number, 0.0));
+
+    // A summary is only isolated if it is pure as well; see mark_pure_summaries.
+    result.isolated_m = result.kind_m != binspector_analyzer_t::field_kind_signal_k &&
+                        result.kind_m != binspector_analyzer_t::field_kind_notify_k &&
+                        is_local(*result.expression_m) &&
+                        is_local(*result.size_expression_m) &&
+                        is_local(*result.offset_expression_m) &&
+                        is_local(*result.alignment_expression_m) &&
+                        is_local(*result.bit_count_expression_m) &&
+                        is_local(*result.is_big_endian_expression_m);
+    result.referenced_m          = true;  // see mark_referenced_fields
+    result.elements_referenced_m = true;
+    result.lazy_m                = false; // see mark_lazy_sentries
+    result.pure_m                = false; // see mark_pure_summaries
+
+    if (result.type_name_m) {
+        binspector_analyzer_t::compiled_structure_map_t::const_iterator found(
+            structure_map.find(result.type_name_m));
+
+        if (found != structure_map.end())
+            result.structure_m = &found->second;
+    }
+
+    return result;
+}
+
+/****************************************************************************************************/
+
 } // namespace
 
 /****************************************************************************************************/
@@ -127,16 +621,32 @@ std::size_t highest_byte_for(boost::uint64_t value) {
 #endif
 /****************************************************************************************************/
 
-binspector_analyzer_t::binspector_analyzer_t(std::istream& binary_file,
-                                             std::ostream& output,
-                                             std::ostream& error)
-    : input_m(binary_file), output_m(output), error_m(error), current_structure_m(0),
+binspector_analyzer_t::binspector_analyzer_t(const boost::filesystem::path& binary_path,
+                                             std::ostream&                  output,
+                                             std::ostream&                  error)
+    : input_m(binary_path), output_m(output), error_m(error), current_structure_m(0),
       current_enumerated_found_m(false), current_sentry_m(invalid_position_k),
-      forest_m(new inspection_forest_t), eof_signalled_m(false), quiet_m(false),
+      forest_m(new inspection_forest_t), eof_signalled_m(false), quiet_m(false), parallel_m(false),
+      skeleton_m(false), streaming_m(false), lazy_m(false), incremental_m(false), worker_m(false),
+      expanding_m(false), node_stats_m(false), peak_node_count_m(0), analyzed_forest_m(nullptr),
       last_line_number_m(0) {}
 
 /****************************************************************************************************/
 
+binspector_analyzer_t::binspector_analyzer_t(binspector_analyzer_t& owner, std::ostream& messages)
+    : input_m(owner.input_m), output_m(messages), error_m(messages), current_structure_m(0),
+      typedef_scope_m(owner.typedef_snapshot()),
+      current_enumerated_value_m(owner.current_enumerated_value_m),
+      current_enumerated_option_set_m(owner.current_enumerated_option_set_m),
+      current_enumerated_found_m(owner.current_enumerated_found_m),
+      current_sentry_m(invalid_position_k), forest_m(new inspection_forest_t),
+      eof_signalled_m(owner.eof_signalled_m), quiet_m(owner.quiet_m), parallel_m(false),
+      skeleton_m(owner.skeleton_m), streaming_m(false), lazy_m(false), incremental_m(false),
+      worker_m(true), expanding_m(false), node_stats_m(false), peak_node_count_m(0),
+      analyzed_forest_m(nullptr), last_line_number_m(0) {}
+
+/****************************************************************************************************/
+
 void binspector_analyzer_t::set_current_structure(adobe::name_t structure_name) {
     current_structure_m = &structure_map_m[structure_name];
 }
@@ -205,19 +715,39 @@ bool binspector_analyzer_t::jump_into_structure(adobe::name_t       structure_na
 
 /****************************************************************************************************/
 
-bool binspector_analyzer_t::jump_into_structure(const adobe::dictionary_t& field,
-                                                inspection_branch_t        parent) {
-    return jump_into_structure(get_value(field, key_named_type_name).cast<adobe::name_t>(), parent);
+const binspector_analyzer_t::compiled_structure_t& binspector_analyzer_t::structure_for(
+    const field_descriptor_t& field) {
+    if (field.structure_m == 0)
+        return structure_for(field.type_name_m);
+
+    return *field.structure_m;
 }
 
 /****************************************************************************************************/
 
 bool binspector_analyzer_t::analyze_binary(const std::string& starting_struct) {
+    compile_structures();
+
     input_m.seek(bitreader_t::pos_t());
+    input_m.set_reach(bitreader_t::pos_t());
     forest_m->clear();
-    current_typedef_map_m.clear();
+    typedef_scope_m.clear();
+
+    eof_signalled_m   = false;
+    starting_struct_m = adobe::name_t(starting_struct.c_str());
+    analyzed_forest_m = forest_m.get();
 
-    inspection_branch_t branch(new_branch(forest_m->begin()));
+    checkpoints_m.clear();
+    signal_log_m.clear();
+
+    // where reanalyze goes back to if it has to start over
+    if (incremental_m) {
+        output_start_m = output_m.tellp();
+        error_start_m  = error_m.tellp();
+    }
+
+    // main is the one branch without a parent.
+    inspection_branch_t branch(forest_m->insert(forest_m->begin(), forest_node_t()));
     forest_node_t&      branch_data(*branch);
     adobe::name_t       starting_struct_name(starting_struct.c_str());
 
@@ -229,753 +759,2279 @@ bool binspector_analyzer_t::analyze_binary(const std::string& starting_struct) {
 }
 
 /****************************************************************************************************/
+/*
+    With set_incremental, analysis takes a checkpoint between each of the fields of main and each of
+    the elements of an array in it, noting how far into the file it had been by then (see
+    bitreader_t::reach). Nothing analyzed before a checkpoint depended on the bytes past its reach,
+    so an edit past it leaves everything before the checkpoint as it was: the forest is cut back to
+    what it held then and analysis carries on from there in the edited file.
+
+    Consts and slots kept from before the checkpoint are evaluated again the next time they are
+    looked up, as what they depend on may be later in the file. Summaries are kept: those left to be
+    rendered are pure (see mark_pure_summaries). Use counts are kept as they were. The messages
+    written since the checkpoint are taken back, and written again as the edited file has them.
+*/
+bool binspector_analyzer_t::reanalyze(auto_forest_t                  forest,
+                                      const boost::filesystem::path& binary_path,
+                                      const byte_range_set_t&        modified) {
+    bitreader_t input(binary_path);
 
-inspection_branch_t binspector_analyzer_t::new_branch(inspection_branch_t with_parent) {
-    with_parent.edge() = adobe::forest_trailing_edge;
+    input.set_cache(input_m.cache_block_size(), input_m.cache_block_count());
 
-    return forest_m->insert(with_parent, forest_node_t());
-}
+    boost::uint64_t first_modified(std::numeric_limits<boost::uint64_t>::max());
 
-/****************************************************************************************************/
+    for (const auto& range : modified)
+        if (range.first < range.second)
+            first_modified = std::min(first_modified, range.first);
 
-template <typename T>
-T binspector_analyzer_t::eval_here(const adobe::array_t& expression) {
-    restore_point_t restore_point(input_m);
+    // An edit that changes the size of the file moves everything after it.
+    bool same_forest(forest && forest.get() == analyzed_forest_m);
+    bool same_size(input.size() == input_m.size());
 
-    // "here" being the current location the file format AST.
-    return contextual_evaluation_of<T>(expression, forest_m->begin(), current_leaf_m, input_m);
-}
+    // the latest checkpoint that had not been as far as the first edit
+    std::vector<checkpoint_t>::iterator found(std::partition_point(
+        checkpoints_m.begin(), checkpoints_m.end(), [&](const checkpoint_t& checkpoint) {
+            return checkpoint.reach_m <= bytepos(first_modified);
+        }));
 
-// specialization because double doesn't always implicitly convert to boost::uint64_t
-template <>
-boost::uint64_t binspector_analyzer_t::eval_here(const adobe::array_t& expression) {
-    return static_cast<boost::uint64_t>(eval_here<double>(expression));
+    forest_m = forest ? std::move(forest) : auto_forest_t(new inspection_forest_t);
+    input_m  = std::move(input);
+
+    if (!same_forest || !same_size || found == checkpoints_m.begin()) {
+        if (incremental_m) {
+            output_m.seekp(output_start_m);
+            error_m.seekp(error_start_m);
+        }
+
+        return analyze_binary(starting_struct_m.c_str());
+    }
+
+    checkpoint_t checkpoint(std::move(*--found));
+
+    // the first step from it takes it again
+    checkpoints_m.erase(found, checkpoints_m.end());
+
+    restore(checkpoint);
+
+    return run_frames(0);
 }
 
 /****************************************************************************************************/
 
-void binspector_analyzer_t::signal_end_of_file() {
-    // If this is true then we've reached eof once already and are continuing to
-    // try and read the file. As such be a little more draconian: throw.
-    if (eof_signalled_m)
-        throw std::runtime_error("EOF reached. Consider using the eof slot.");
+inspection_branch_t binspector_analyzer_t::new_branch(inspection_branch_t with_parent,
+                                                      adobe::name_t       name) {
+    inspection_branch_t parent(with_parent);
 
-    eof_signalled_m = true;
+    with_parent.edge() = adobe::forest_trailing_edge;
 
-    try {
-        adobe::array_t expression;
+    inspection_branch_t branch(forest_m->insert(with_parent, forest_node_t()));
 
-        expression.push_back(adobe::any_regular_t("eof"_name));
-        expression.push_back(adobe::any_regular_t(adobe::variable_k));
+    link_child(parent, branch);
 
-        inspection_branch_t slot(eval_here<inspection_branch_t>(expression));
+    if (name) {
+        branch->name_m = name;
 
-        // actually update the slot with a new expression and clear the cache
-        slot->expression_m = adobe::array_t(1, adobe::any_regular_t(true));
-        slot->evaluated_m  = false;
-    } catch (...) {
+        index_child(parent, branch);
     }
+
+    return branch;
 }
 
 /****************************************************************************************************/
 
-template <typename T>
-T binspector_analyzer_t::identifier_lookup(adobe::name_t identifier) {
-    adobe::array_t expression;
-
-    expression.push_back(adobe::any_regular_t(identifier));
-    expression.push_back(adobe::any_regular_t(adobe::variable_k));
+inspection_branch_t binspector_analyzer_t::new_array_element(inspection_branch_t root) {
+    inspection_branch_t element(new_branch(root));
 
-    return eval_here<T>(expression);
-}
+    element->set_flag(is_array_element_k);
+    element->cardinal_m = root->cardinal_m++;
 
-/****************************************************************************************************/
+    table_element(root, element);
 
-void binspector_analyzer_t::set_quiet(bool quiet) {
-    quiet_m = quiet;
+    return element;
 }
 
 /****************************************************************************************************/
 
-bool binspector_analyzer_t::analyze_with_structure(const structure_type& structure,
-                                                   inspection_branch_t   parent) try {
-    static const adobe::array_t empty_array_k;
+void binspector_analyzer_t::compile_structures() {
+    compiled_structure_map_m.clear();
+    expression_pool_m.clear();
 
-    temp_assignment<inspection_branch_t> node_stack(current_leaf_m, parent);
-    save_restore<typedef_map_t>          typedef_map_stack(current_typedef_map_m);
-    bool                                 last_conditional_value(false);
+    // Every structure gets its entry before any are filled in, so the structure pointers taken by
+    // compile_field stay put.
+    for (const auto& structure : structure_map_m)
+        compiled_structure_map_m[structure.first];
 
-    for (structure_type::const_iterator iter(structure.begin()), last(structure.end());
-         iter != last;
-         ++iter) {
-        adobe::dictionary_t field(iter->cast<adobe::dictionary_t>());
-        adobe::name_t       type(value_for<adobe::name_t>(field, key_field_type));
-        adobe::name_t       name(value_for<adobe::name_t>(field, key_field_name));
+    for (const auto& structure : structure_map_m) {
+        compiled_structure_t& compiled(compiled_structure_map_m[structure.first]);
 
-        // The very first thing we want to do is the typedef resolution. This gives us the ability
-        // to assert that the field dictionary is going to be the actual field once the typedef
-        // lookup has completed.
-        if (type == value_field_type_typedef_atom || type == value_field_type_typedef_named) {
-            // add the typedef's field details to the typedef map; we're done
-            current_typedef_map_m[name] = field;
+        compiled.reserve(structure.second.size());
 
-            continue;
-        }
+        for (const auto& field : structure.second)
+            compiled.push_back(
+                compile_field(field.cast<adobe::dictionary_t>(),
+                              compiled_structure_map_m,
+                              expression_pool_m));
+    }
 
-        // Here we do the typename lookup if necessary and set the field appropriately.
-        // If the name lookup is not necessary (i.e., we have found any type other than
-        // a named type) then we just use the field pointed to by the current iterator.
-        if (type == value_field_type_named) {
-            field = typedef_lookup(current_typedef_map_m, field);
+    compile_enumerations();
 
-            // re-set these values given that the field may have changed.
-            type = value_for<adobe::name_t>(field, key_field_type);
-            name = value_for<adobe::name_t>(field, key_field_name);
-        }
+    mark_referenced_fields();
 
-        bool                     has_conditional_type(field.count(key_field_conditional_type) != 0);
-        conditional_expression_t conditional_type(
-            has_conditional_type ?
-                value_for<conditional_expression_t>(field, key_field_conditional_type) :
-                none_k);
-        bool is_conditional(conditional_type != none_k);
-
-        last_name_m        = name;
-        last_filename_m    = value_for<std::string>(field, key_parse_info_filename);
-        last_line_number_m = value_for<double>(field, key_parse_info_line_number);
-
-        // if our field is conditional check if condition holds; if not continue past field
-        if (is_conditional) {
-            if (conditional_type == else_k) {
-                // if we've already found our true expression in this block skip this one
-                if (last_conditional_value)
-                    continue;
+    mark_pure_summaries();
 
-                last_conditional_value = true;
-            } else // conditional_type == if_k
-            {
-                const adobe::array_t& if_expression(
-                    value_for<adobe::array_t>(field, key_field_if_expression));
+    mark_lazy_sentries();
+}
 
-                last_conditional_value = eval_here<bool>(if_expression);
-            }
+/****************************************************************************************************/
 
-            if (last_conditional_value) {
-                // jump in to the conditional block but use the same parent as the
-                // on that came in - this will add the conditional block's items
-                // to the parent, flattening out the conditional.
+void binspector_analyzer_t::compile_enumerations() {
+    enumeration_pool_m.clear();
 
-                if (jump_into_structure(field, parent) == false)
-                    return false;
-            }
+    for (auto& structure : compiled_structure_map_m) {
+        for (auto& field : structure.second) {
+            if (field.kind_m != field_kind_enumerated_k || field.structure_m == 0)
+                continue;
 
-            // we're done with this conditional whether true or false
-            continue;
-        } else if (type == value_field_type_invariant) {
-            const adobe::array_t& expression(
-                value_for<adobe::array_t>(field, key_field_assign_expression));
-            bool holds(eval_here<bool>(expression));
+            // The parser puts the options first and the default, if any, last. An option body runs
+            // for every option that matches, so duplicate values keep the sequential dispatch.
+            enumeration_t enumeration;
+            bool          tabled(true);
 
-            if (!holds)
-                throw std::runtime_error(
-                    adobe::make_string("invariant '", name.c_str(), "' failed to hold."));
+            enumeration.default_m = 0;
 
-            continue;
-        } else if (type == value_field_type_enumerated) {
-            const adobe::array_t& branch_expression(
-                value_for<adobe::array_t>(field, key_enumerated_expression));
-            inspection_branch_t  atom(eval_here<inspection_branch_t>(branch_expression));
-            adobe::any_regular_t value;
+            for (const auto& option : *field.structure_m) {
+                if (option.kind_m == field_kind_enumerated_default_k) {
+                    enumeration.default_m = &option;
 
-            {
-                restore_point_t restore_point(input_m);
+                    continue;
+                }
 
-                value =
-                    finalize_lookup<adobe::any_regular_t>(forest_m->begin(), atom, input_m, true);
-            }
+                const compiled_expression_t& expression(*option.expression_m);
 
-            temp_assignment<adobe::any_regular_t> enumerated_value(current_enumerated_value_m,
-                                                                   value);
-            temp_assignment<bool>           enumerated_found(current_enumerated_found_m, false);
-            temp_assignment<adobe::array_t> enumerated_option_set(current_enumerated_option_set_m,
-                                                                  adobe::array_t());
+                if (option.kind_m != field_kind_enumerated_option_k || !expression.is_constant() ||
+                    expression.constant_value().type_info() != typeid(double) ||
+                    enumeration.default_m != 0) {
+                    tabled = false;
 
-            if (jump_into_structure(field, parent) == false)
-                return false;
+                    break;
+                }
+
+                double value(expression.constant_value().cast<double>());
 
-            if (current_enumerated_found_m) {
-                if (!atom->option_set_m.empty()) {
-                    // This warning may need to be more clear, as its not
-                    // last_path_m that is the cause of the warning but the
-                    // option_set_m within the atom. (last_path() is the line
-                    // in the code that caused the warning.)
+                if (!enumeration.option_map_m.insert(std::make_pair(value, &option)).second) {
+                    tabled = false;
 
-                    error_m << "WARNING: " << build_path(atom) << " has multiple enumerate sets!\n";
+                    break;
                 }
 
-                // This stores within the enumerated node all the possible options
-                // found in the AST. This will give the fuzzer a set of valid options
-                // with which it can tweak this value and otherwise wreak smart
-                // havoc with the file format.
+                enumeration.option_set_m.push_back(expression.constant_value());
+            }
 
-                atom->option_set_m = current_enumerated_option_set_m;
-            } else {
-                std::string error;
+            if (!tabled)
+                continue;
+
+            enumeration_pool_m.push_back(std::move(enumeration));
 
-                // REVISIT (fbrereto) : We have to have a cleaner solution than
-                //                      this kind of concatenation...
-                error += "value for " + build_path(atom) + " is not enumerated (" +
-                         serialize(value) + ")";
+            field.enumeration_m = &enumeration_pool_m.back();
+        }
+    }
+}
+
+/****************************************************************************************************/
 
-                throw std::runtime_error(error);
+void binspector_analyzer_t::mark_referenced_fields() {
+    // Fields are only ever found by name, so one no expression names can be placed but never read.
+    // Which nodes an expression reaches is only known as it runs; this errs toward keeping them.
+    //
+    // A bare name is found at or above the node being analyzed, so once a struct is done, what is
+    // in it can only be found by late_names_m: names looked up as subfields, and names in the
+    // expressions that are evaluated later. Those are summaries, and consts and slots (with the
+    // signals that set them), which are evaluated when they are looked up: late, if they can be.
+    typedef std::pair<adobe::name_t, const compiled_expression_t*> evaluated_on_lookup_t;
+
+    std::set<adobe::name_t>            names;
+    std::set<adobe::name_t>            element_names;
+    std::vector<evaluated_on_lookup_t> on_lookup;
+    bool                               everything(false);
+
+    late_names_m.clear();
+
+    names.insert("eof"_name); // see signal_end_of_file
+    late_names_m.insert("eof"_name);
+
+    for (auto& structure : compiled_structure_map_m) {
+        for (auto& field : structure.second) {
+            const compiled_expression_t* expressions[] = {field.expression_m,
+                                                          field.size_expression_m,
+                                                          field.offset_expression_m,
+                                                          field.alignment_expression_m,
+                                                          field.bit_count_expression_m,
+                                                          field.is_big_endian_expression_m};
+
+            field.referenced_m = false;
+
+            // a signal names the slot it updates
+            if (field.kind_m == field_kind_signal_k)
+                names.insert(field.name_m);
+
+            for (const compiled_expression_t* expression : expressions) {
+                if (add_names(*expression, names))
+                    field.referenced_m = true;
+
+                // the virtual machine could look up anything
+                if (expression->fallback())
+                    everything = true;
+
+                add_element_names(*expression, element_names);
+                add_subfield_names(*expression, late_names_m);
             }
 
-            continue;
-        } else if (type == value_field_type_enumerated_option) {
-            const adobe::array_t& expression(
-                value_for<adobe::array_t>(field, key_enumerated_option_expression));
-            adobe::any_regular_t option_value(eval_here<adobe::any_regular_t>(expression));
+            if (field.kind_m == field_kind_summary_k)
+                add_names(*field.expression_m, late_names_m);
+            else if (field.kind_m == field_kind_const_k || field.kind_m == field_kind_slot_k ||
+                     field.kind_m == field_kind_signal_k)
+                on_lookup.push_back(evaluated_on_lookup_t(field.name_m, field.expression_m));
+        }
+    }
 
-            current_enumerated_option_set_m.push_back(option_value);
+    // A const looked up late can look up late whatever it names in turn.
+    for (bool more(true); more;) {
+        more = false;
 
-            if (option_value == current_enumerated_value_m) {
-                if (jump_into_structure(field, parent) == false)
-                    return false;
+        for (auto iter(on_lookup.begin()); iter != on_lookup.end();) {
+            if (late_names_m.count(iter->first) == 0) {
+                ++iter;
 
-                current_enumerated_found_m = true;
+                continue;
             }
 
-            continue;
-        } else if (type == value_field_type_enumerated_default) {
-            if (!current_enumerated_found_m) {
-                if (jump_into_structure(field, parent) == false)
-                    return false;
+            add_names(*iter->second, late_names_m);
 
-                current_enumerated_found_m = true;
-            }
+            iter = on_lookup.erase(iter);
+            more = true;
+        }
+    }
 
-            continue;
-        } else if (type == value_field_type_sentry) {
-            const adobe::array_t& expression(
-                value_for<adobe::array_t>(field, key_sentry_expression));
-            adobe::any_regular_t sentry_value(eval_here<adobe::any_regular_t>(expression));
-            bitreader_t::pos_t   sentry_position;
-
-            // Values of type double are relative to the current input position;
-            // values of type pos_t are absolute.
-
-            if (sentry_value.type_info() == typeid(double))
-                sentry_position = input_m.pos() + bytepos(sentry_value.cast<double>());
-            else if (sentry_value.type_info() == typeid(bitreader_t::pos_t))
-                sentry_position = sentry_value.cast<bitreader_t::pos_t>();
-            else
-                throw std::runtime_error("Unexpected sentry type");
+    for (auto& structure : compiled_structure_map_m) {
+        for (auto& field : structure.second) {
+            field.referenced_m = everything || field.referenced_m || names.count(field.name_m);
+            field.elements_referenced_m = everything || element_names.count(field.name_m);
 
-            {
-                temp_assignment<bitreader_t::pos_t> sentry_holder(current_sentry_m,
-                                                                  sentry_position);
-                temp_assignment<std::string> sentry_name_holder(current_sentry_set_path_m,
-                                                                last_path());
+            if (everything)
+                late_names_m.insert(field.name_m);
+        }
+    }
+}
 
-                // std::cerr << "! sentry set to " << sentry_position << '\n';
+/****************************************************************************************************/
 
-                if (jump_into_structure(field, parent) == false)
-                    return false;
-            }
+void binspector_analyzer_t::mark_lazy_sentries() {
+    // A body can wait until it is first looked at so long as analyzing it then changes nothing but
+    // the node it goes into: down through every structure it names, it signals and notifies nothing
+    // and never reaches for main (see compile_field). Names it looks up above the node are found as
+    // they are when it is analyzed. Named fields are only resolved as they are reached, and
+    // analyze_field turns away those that reach further.
+    for (auto& structure : compiled_structure_map_m) {
+        for (auto& field : structure.second) {
+            if (field.kind_m != field_kind_sentry_k || field.structure_m == 0)
+                continue;
 
-            // Now we check to see not if we've gone beyond the sentry
-            // but instead haven't reached it (e.g., we were told the
-            // size would be 100 bytes but only analyzed 99.) While this
-            // isn't necessarily fatal (hence the warning and not an
-            // error) it may point to errors in the template definition.
-            if (input_m.pos() != sentry_position) {
-                error_m << "WARNING: After " << current_sentry_set_path_m
-                        << " sentry, read position should be " << sentry_position
-                        << " but instead is " << input_m.pos() << ".";
+            std::set<const compiled_structure_t*>    seen;
+            std::vector<const compiled_structure_t*> blocks(1, field.structure_m);
+            bool                                     lazy(true);
 
-#if 0
-                error_m << " Position forced!";
+            while (lazy && !blocks.empty()) {
+                const compiled_structure_t* block(blocks.back());
 
-                // In the event the sentry is violated, put the read head
-                // where it is expected. This will give us our best chance
-                // at being able to continue reading the file without
-                // further issue. This means we're trusting the length
-                // prefixes in a document more than the actual data that's
-                // in there, which is philosophically debatable, I'm sure.
-                input_m.seek(sentry_position);
-#endif
+                blocks.pop_back();
 
-                error_m << '\n';
+                if (!seen.insert(block).second)
+                    continue;
+
+                for (const auto& body_field : *block) {
+                    lazy = lazy && body_field.isolated_m;
+
+                    if (body_field.structure_m)
+                        blocks.push_back(body_field.structure_m);
+                }
             }
 
-            continue;
-        } else if (type == value_field_type_notify) {
-            // REVISIT (fbrereto) : Refactor and unify this code with value_field_type_summary
+            field.lazy_m = lazy;
+        }
+    }
+}
 
-            if (quiet_m)
+/****************************************************************************************************/
+
+void binspector_analyzer_t::mark_pure_summaries() {
+    // A summary left to be rendered when it is shown has to come out as it would have during
+    // analysis. What can change by then is anything a signal or eof sets, a const evaluated later
+    // than it would have been, the read position, the struct itself (it is not done yet) and
+    // whatever main holds. A summary that reads none of those is pure; see also analyze_field,
+    // which checks the names it looks up are already in the struct.
+    std::set<adobe::name_t> late_names;
+
+    late_names.insert("eof"_name);
+
+    for (const auto& structure : compiled_structure_map_m)
+        for (const auto& field : structure.second)
+            if (field.kind_m == field_kind_const_k || field.kind_m == field_kind_slot_k ||
+                field.kind_m == field_kind_signal_k)
+                late_names.insert(field.name_m);
+
+    for (auto& structure : compiled_structure_map_m) {
+        for (auto& field : structure.second) {
+            if (field.kind_m != field_kind_summary_k)
                 continue;
 
-            const adobe::array_t& expression(
-                value_for<adobe::array_t>(field, key_notify_expression));
-            adobe::array_t    argument_set(eval_here<adobe::array_t>(expression));
-            std::stringstream result;
+            const compiled_expression_t& expression(*field.expression_m);
+            std::set<adobe::name_t>      names;
 
-            adobe::copy(argument_set, std::ostream_iterator<adobe::any_regular_t>(result));
+            field.pure_m = !expression.fallback() && !add_names(expression, names);
 
-            output_m << result.str() << '\n';
+            for (const auto& instruction : expression.code())
+                if (instruction.opcode_m == op_main_k ||
+                    (instruction.opcode_m == op_call_k &&
+                     (instruction.operand_m == builtin_gtell_k ||
+                      instruction.operand_m == builtin_peek_k ||
+                      instruction.operand_m == builtin_print_k)))
+                    field.pure_m = false;
 
-            continue;
-        } else if (type == value_field_type_summary) {
-            // REVISIT (fbrereto) : Refactor and unify this code with value_field_type_notify
+            for (adobe::name_t name : names)
+                if (late_names.count(name))
+                    field.pure_m = false;
 
-            if (quiet_m)
-                continue;
+            // An impure one is rendered as it is reached, and so needs what is above the struct.
+            field.isolated_m = field.isolated_m && field.pure_m;
+        }
+    }
+}
 
-            const adobe::array_t& expression(
-                value_for<adobe::array_t>(field, key_summary_expression));
-            adobe::array_t    argument_set(eval_here<adobe::array_t>(expression));
-            std::stringstream result;
-
-            // REVISIT (fbrereto) : I would like to be able to specify a serialization routien for
-            //                      inspection_branch_t at this point, so I don't have to do this
-            //                      kind of manual looping, however changes will need to go into ASL
-            //                      to make that happen, so this is a bit of a hack.
-            for (const auto& entry : argument_set) {
-                if (entry.type_info() == typeid(inspection_branch_t)) {
-                    result << entry.cast<inspection_branch_t>()->summary_m;
-                } else {
-                    result << entry;
-                }
-            }
+/****************************************************************************************************/
 
-            parent->summary_m = result.str();
+void binspector_analyzer_t::typedef_scope_t::clear() {
+    base_m.reset();
+    table_m.clear();
+    undo_m.clear();
+    dependents_m.clear();
 
-            continue;
-        } else if (type == value_field_type_die) {
-            const adobe::array_t& expression(value_for<adobe::array_t>(field, key_die_expression));
-            adobe::array_t        argument_set(eval_here<adobe::array_t>(expression));
-            std::stringstream     result;
+    ++generation_m;
+}
 
-            result << "die: ";
+/****************************************************************************************************/
 
-            adobe::copy(argument_set, std::ostream_iterator<adobe::any_regular_t>(result));
+const binspector_analyzer_t::field_descriptor_t* binspector_analyzer_t::typedef_scope_t::find(
+    adobe::name_t name) const {
+    table_t::const_iterator found(table_m.find(name));
 
-            throw std::runtime_error(result.str());
-        } else if (type == value_field_type_signal) {
-            inspection_branch_t slot(identifier_lookup<inspection_branch_t>(name));
+    // An entry rolled back to nothing hid nothing in base_m either; see define.
+    if (found != table_m.end())
+        return found->second.typedef_m;
+
+    return base_m ? base_m->find(name) : 0;
+}
+
+/****************************************************************************************************/
 
-            // actually update the slot with a new expression and clear the cache
-            slot->expression_m = value_for<adobe::array_t>(field, key_field_assign_expression);
-            slot->evaluated_m  = false;
+void binspector_analyzer_t::typedef_scope_t::set(adobe::name_t             name,
+                                                 const field_descriptor_t* field) {
+    entry_t& entry(table_m[name]);
 
-            continue;
+    entry.typedef_m  = field;
+    entry.resolved_m = false;
+
+    // Only the chains that ran through this name are resolved again. (In TIFF, for one, each IFD
+    // entry defines and rolls back its own field_t; chains that don't involve it are kept.)
+    dependent_map_t::iterator dependents(dependents_m.find(name));
+
+    if (dependents != dependents_m.end()) {
+        for (adobe::name_t dependent : dependents->second) {
+            table_t::iterator found(table_m.find(dependent));
+
+            if (found != table_m.end())
+                found->second.resolved_m = false;
         }
 
-        // !!!!! NOTICE !!!!!
-        //
-        // From this point on we've actually added a node to the analysis forest.
-        // So if you want to do anything during analysis without affecting the
-        // forest, do it above this comment. (Also, make sure this comment stays
-        // with the sub_branch creation so we have something obvious to demarcate
-        // when a node is added to the forest.)
+        dependents_m.erase(dependents);
+    }
 
-        inspection_branch_t sub_branch(new_branch(parent));
-        forest_node_t&      branch_data(*sub_branch);
+    ++generation_m;
+}
 
-        temp_assignment<inspection_branch_t> node_stack(current_leaf_m, sub_branch);
+/****************************************************************************************************/
 
-        try {
-            branch_data.name_m = name;
-
-            if (type == value_field_type_struct)
-                branch_data.set_flag(type_struct_k);
-            else if (type == value_field_type_atom)
-                branch_data.set_flag(type_atom_k);
-            else if (type == value_field_type_const)
-                branch_data.set_flag(type_const_k);
-            else if (type == value_field_type_skip)
-                branch_data.set_flag(type_skip_k);
-            else if (type == value_field_type_slot)
-                branch_data.set_flag(type_slot_k);
-            else
-                throw std::runtime_error(
-                    adobe::make_string("analysis error: unknown type: ", type.c_str()));
+void binspector_analyzer_t::typedef_scope_t::define(const field_descriptor_t& field) {
+    undo_m.push_back(std::make_pair(field.name_m, find(field.name_m)));
 
-            if (type == value_field_type_const) {
-                branch_data.expression_m = value_for<adobe::array_t>(field, key_const_expression);
-                branch_data.no_print_m   = value_for<bool>(field, key_const_no_print);
+    set(field.name_m, &field);
+}
 
-                continue;
-            } else if (type == value_field_type_skip) {
-                // skip is different in that its parameter is unit BYTES not bits
-                const adobe::array_t& skip_expression(
-                    value_for<adobe::array_t>(field, key_skip_expression));
-                boost::uint64_t byte_count(
-                    static_cast<boost::uint64_t>(eval_here<double>(skip_expression)));
+/****************************************************************************************************/
 
-                branch_data.start_offset_m = input_m.pos();
+void binspector_analyzer_t::typedef_scope_t::rollback(mark_t mark) {
+    while (undo_m.size() != mark) {
+        set(undo_m.back().first, undo_m.back().second);
 
-                if (parent->start_offset_m == invalid_position_k)
-                    parent->start_offset_m = input_m.pos();
+        undo_m.pop_back();
+    }
+}
 
-                // skip the bytes here
-                branch_data.bit_count_m = byte_count * 8;
-                branch_data.location_m  = make_location(branch_data.bit_count_m);
+/****************************************************************************************************/
 
-                branch_data.end_offset_m = input_m.pos() - inspection_byte_k;
-                parent->end_offset_m     = branch_data.end_offset_m;
+binspector_analyzer_t::field_descriptor_t binspector_analyzer_t::typedef_scope_t::resolve(
+    field_descriptor_t field) const {
+    // The same resolution as typedef_lookup, but on descriptors.
+    table_t::const_iterator   found(table_m.find(field.type_name_m));
+    const field_descriptor_t* named(0);
+    const field_descriptor_t* atom(0);
+
+    if (found == table_m.end() && base_m && base_m->find(field.type_name_m) != 0) {
+        // Shared with other threads, so walked here without caching anything in it. The walk goes
+        // through find, so anything defined here since hides what base_m has.
+        const field_descriptor_t* type(base_m->find(field.type_name_m));
+
+        while (type != 0 && type->kind_m != field_kind_typedef_atom_k) {
+            named = type;
+            type  = find(type->type_name_m);
+        }
 
-                continue;
-            } else if (type == value_field_type_slot) {
-                branch_data.expression_m =
-                    value_for<adobe::array_t>(field, key_field_assign_expression);
+        atom = type;
+    } else if (found == table_m.end() || found->second.typedef_m == 0) {
+        // found a top level identity that is neither an atom nor another possible
+        // typedef. At this point we either have a name of a structure or we have
+        // something mistyped by the user.
+        field.kind_m = field_kind_struct_k;
 
-                continue;
-            }
+        return field;
+    } else {
+        const entry_t& entry(found->second);
 
-            field_size_t field_size_type(value_for<field_size_t>(field, key_field_size_type));
-            bool         has_size_expression(field_size_type != field_size_none_k);
-            const adobe::array_t& field_size_expression(
-                value_for<adobe::array_t>(field, key_field_size_expression));
+        if (!entry.resolved_m) {
+            const field_descriptor_t* type(entry.typedef_m);
 
-            if (has_size_expression) {
-                branch_data.set_flag(is_array_root_k);
-                branch_data.cardinal_m = 0; // loops will overwrite
-                branch_data.shuffle_m  = value_for<bool>(field, key_field_shuffle);
-            }
+            entry.named_m = 0;
 
-            inspection_position_t position_save(input_m.pos());
-            const adobe::array_t& offset_expression(
-                value_for<adobe::array_t>(field, key_field_offset_expression));
-            bool remote_position(!offset_expression.empty());
-
-            if (remote_position) {
-                // if our field's data is not at the next immediate offset,
-                // temporarily set the position marker to that offset location
-                // and restore it later.
-                adobe::any_regular_t offset_value(
-                    eval_here<adobe::any_regular_t>(offset_expression));
-                inspection_position_t offset;
-
-                if (offset_value.type_info() == typeid(double))
-                    offset = bytepos(offset_value.cast<double>());
-                else if (offset_value.type_info() == typeid(inspection_position_t))
-                    offset = offset_value.cast<inspection_position_t>();
-                else
-                    throw std::runtime_error("Expected a position or a double for the offset");
-
-                input_m.seek(offset);
-            } else {
-                // If it's not a remote position we want to cache the start
-                // offset for this node in its parent, but only if it hasn't
-                // already been set.
-                if (parent->start_offset_m == invalid_position_k)
-                    parent->start_offset_m = input_m.pos();
-            }
+            // only typedefs make it into the table, so anything but an atom names another type.
+            while (type != 0 && type->kind_m != field_kind_typedef_atom_k) {
+                entry.named_m = type;
 
-            if (type == value_field_type_struct) {
-                adobe::name_t struct_name(value_for<adobe::name_t>(field, key_named_type_name));
-
-                branch_data.struct_name_m = struct_name;
-
-                if (has_size_expression) {
-                    // a loop means branch_data is an array root, so we must
-                    // update the start and end offset for it.
-                    branch_data.start_offset_m = input_m.pos();
-                    branch_data.end_offset_m   = input_m.pos();
-
-                    if (field_size_type == field_size_while_k) {
-                        while (eval_here<bool>(field_size_expression)) {
-                            inspection_branch_t array_element_branch(new_branch(sub_branch));
-                            forest_node_t&      array_element_data(*array_element_branch);
-
-                            array_element_data.set_flag(is_array_element_k);
-                            array_element_data.cardinal_m = branch_data.cardinal_m++;
-
-                            if (jump_into_structure(struct_name, array_element_branch) == false)
-                                return false;
-
-                            // We keep the end offset up to date because it
-                            // may be used by the while predicate
-                            branch_data.end_offset_m = input_m.pos() - inspection_byte_k;
-                        }
-                    } else if (field_size_type == field_size_integer_k) {
-                        double size_count_double(eval_here<double>(field_size_expression));
-
-                        if (size_count_double < 0)
-                            throw std::runtime_error("Negative bounds size for array");
-
-                        std::size_t size_count(static_cast<std::size_t>(size_count_double));
-
-                        while (branch_data.cardinal_m != size_count) {
-                            inspection_branch_t array_element_branch(new_branch(sub_branch));
-                            forest_node_t&      array_element_data(*array_element_branch);
-
-                            array_element_data.set_flag(is_array_element_k);
-                            array_element_data.cardinal_m = branch_data.cardinal_m++;
-
-                            if (jump_into_structure(struct_name, array_element_branch) == false)
-                                return false;
-                        }
-                    } else if (field_size_type == field_size_terminator_k) {
-                        throw std::runtime_error(
-                            "Structure size expression: terminator not allowed");
-                    } else if (field_size_type == field_size_delimiter_k) {
-                        boost::uint64_t delimiter(
-                            eval_here<boost::uint64_t>(field_size_expression));
-                        boost::uint64_t delimiter_byte_count(
-                            std::max<std::size_t>(1, highest_byte_for(delimiter)));
-
-                        while (true) {
-                            boost::uint64_t delimiter_peek(0);
-
-                            {
-                                restore_point_t      restore_point(input_m);
-                                rawbytes_t           raw(input_m.read(delimiter_byte_count));
-                                adobe::any_regular_t peeked_any(
-                                    evaluate(raw, delimiter_byte_count * 8, atom_unsigned_k, true));
-                                delimiter_peek =
-                                    static_cast<boost::uint64_t>(peeked_any.cast<double>());
-                            }
-
-                            if (delimiter_peek == delimiter)
-                                break;
-
-                            inspection_branch_t array_element_branch(new_branch(sub_branch));
-                            forest_node_t&      array_element_data(*array_element_branch);
-
-                            array_element_data.set_flag(is_array_element_k);
-                            array_element_data.cardinal_m = branch_data.cardinal_m++;
-
-                            if (jump_into_structure(struct_name, array_element_branch) == false)
-                                return false;
-                        }
-                    } else {
-                        throw std::runtime_error("Unknown structure size expression type");
-                    }
-
-                    // One final update to the root's end offset should does the trick
-                    branch_data.end_offset_m = input_m.pos() - inspection_byte_k;
-                } else // singleton
-                {
-                    if (jump_into_structure(struct_name, sub_branch) == false)
-                        return false;
-                }
-            } else if (type == value_field_type_atom) {
-                const adobe::array_t& bit_count_expression(
-                    value_for<adobe::array_t>(field, key_atom_bit_count_expression));
-                const adobe::array_t& is_big_endian_expression(
-                    value_for<adobe::array_t>(field, key_atom_is_big_endian_expression));
-                bool is_big_endian(eval_here<bool>(is_big_endian_expression));
-
-                branch_data.bit_count_m =
-                    static_cast<boost::uint64_t>(eval_here<double>(bit_count_expression));
-                branch_data.type_m = value_for<atom_base_type_t>(field, key_atom_base_type);
-                branch_data.set_flag(atom_is_big_endian_k, is_big_endian);
-
-                if (has_size_expression) {
-                    // a loop means branch_data is an array root, so we must
-                    // update the start and end offset for it.
-                    branch_data.start_offset_m = input_m.pos();
-                    branch_data.end_offset_m   = input_m.pos();
-
-                    if (field_size_type == field_size_delimiter_k) {
-                        /*
-                            There is an issue here this code addresses which makes it more complicated,
-                            and I'm not sure if it's necessary but I'm keeping it in. The problem is that
-                            the delimiter you are interested in may not exist in the file aligned to the
-                            current read boundary you have... for example a 16-bit delimiter cannot be
-                            found by simply reading 16 bits at a time and then comparing because you
-                            might read the two halves of the 16 bit value over the course of two
-                            consecutive reads and fail both times. As such we have to read in the data
-                            and push it into a "sliding window" that is the size of the delimiter we
-                            are looking for and do the comparisons that way. It's much slower and the
-                            language might benefit from the user being able to guarantee the alignment
-                            of the values we are looking for, in which case we can improve the
-                            performance here.
-                        */
-                        boost::uint64_t delimiter(
-                            eval_here<boost::uint64_t>(field_size_expression));
-                        boost::uint64_t delimiter_byte_count(
-                            std::max<std::size_t>(1, highest_byte_for(delimiter)));
-                        std::size_t delimiter_bit_count(
-                            static_cast<std::size_t>(delimiter_byte_count * 8));
-                        boost::uint64_t running_count(0);
-                        boost::uint64_t running_stop_value(0);
-                        boost::uint64_t running_stop_value_mask(
-                            delimiter_bit_count == 8 ? 0xff :
-                                                       delimiter_bit_count == 16 ?
-                                                       0xffff :
-                                                       delimiter_bit_count == 32 ? 0xffffffff : -1);
-
-                        {
-                            // because the while loop actually advances the read
-                            // pointer we want to save it off here and restore it
-                            // at the end of the delimiter-finding loop.
-                            restore_point_t restore_point(input_m);
-
-                            while (true) {
-                                rawbytes_t raw(input_m.read(1));
-
-                                if (input_m.fail())
-                                    throw std::runtime_error("Delimiter not found: eof reached");
-
-                                unsigned char c(raw[0]);
-
-                                running_stop_value =
-                                    (running_stop_value << 8 | c) & running_stop_value_mask;
-
-                                if (running_stop_value != delimiter) {
-                                    ++running_count;
-                                } else {
-                                    // we back up by the size of the window
-                                    running_count -= bytesize(delimiter_bit_count) - 1;
-
-                                    break;
-                                }
-                            }
-                        }
-
-                        for (boost::uint64_t i(0); i < running_count; ++i) {
-                            inspection_branch_t array_element_branch(new_branch(sub_branch));
-                            forest_node_t&      array_element_data(*array_element_branch);
-
-                            array_element_data.set_flag(is_array_element_k);
-                            array_element_data.cardinal_m = branch_data.cardinal_m++;
-                            array_element_data.location_m = make_location(branch_data.bit_count_m);
-                        }
-                    } else if (field_size_type == field_size_terminator_k) {
-                        boost::uint64_t terminator(
-                            eval_here<boost::uint64_t>(field_size_expression));
-                        boost::uint8_t read_size(
-                            static_cast<boost::uint8_t>(bytesize(branch_data.bit_count_m)));
-                        boost::uint8_t  read_size_leftovers(bitsize(branch_data.bit_count_m));
-                        boost::uint64_t running_count(0);
-                        boost::uint64_t terminator_mask(
-                            read_size == 1 ?
-                                0xff :
-                                read_size == 2 ? 0xffff : read_size == 4 ? 0xffffffff : -1);
-
-                        if (read_size_leftovers)
-                            throw std::runtime_error(
-                                "Use of non-byte-aligned fields with a terminator not supported.");
-
-                        if (read_size > 8)
-                            throw std::runtime_error("Use of terminators > 64 bits not supported.");
-
-                        {
-                            // because the while loop actually advances the read
-                            // pointer we want to save it off here and restore it
-                            // at the end of the terminator-finding loop.
-                            restore_point_t restore_point(input_m);
-
-                            while (true) {
-                                rawbytes_t raw(input_m.read(read_size));
-
-                                if (input_m.fail())
-                                    throw std::runtime_error("Terminator not found: eof reached");
-
-                                boost::uint64_t* termptr(
-                                    reinterpret_cast<boost::uint64_t*>(&raw[0]));
-                                boost::uint64_t buffer(*termptr & terminator_mask);
-
-                                ++running_count;
-
-                                if (buffer == terminator)
-                                    break;
-                            }
-                        }
-
-                        for (boost::uint64_t i(0); i < running_count; ++i) {
-                            inspection_branch_t array_element_branch(new_branch(sub_branch));
-                            forest_node_t&      array_element_data(*array_element_branch);
-
-                            array_element_data.set_flag(is_array_element_k);
-                            array_element_data.cardinal_m = branch_data.cardinal_m++;
-                            array_element_data.location_m = make_location(branch_data.bit_count_m);
-                        }
-                    } else if (field_size_type == field_size_while_k) {
-                        while (eval_here<bool>(field_size_expression)) {
-                            inspection_branch_t array_element_branch(new_branch(sub_branch));
-                            forest_node_t&      array_element_data(*array_element_branch);
-
-                            array_element_data.set_flag(is_array_element_k);
-                            array_element_data.cardinal_m = branch_data.cardinal_m++;
-                            array_element_data.location_m = make_location(branch_data.bit_count_m);
-                        }
-                    } else if (field_size_type == field_size_integer_k) {
-                        double size_count_double(eval_here<double>(field_size_expression));
-
-                        if (size_count_double < 0)
-                            throw std::runtime_error("Negative bounds size for array");
-
-                        std::size_t size_count(static_cast<std::size_t>(size_count_double));
-
-                        while (branch_data.cardinal_m != size_count) {
-                            inspection_branch_t array_element_branch(new_branch(sub_branch));
-                            forest_node_t&      array_element_data(*array_element_branch);
-
-                            array_element_data.set_flag(is_array_element_k);
-                            array_element_data.cardinal_m = branch_data.cardinal_m++;
-                            array_element_data.location_m = make_location(branch_data.bit_count_m);
-                        }
-                    } else {
-                        throw std::runtime_error("Unknown atom size expression type");
-                    }
-
-                    // One final update to the root's end offset should does the trick
-                    branch_data.end_offset_m = input_m.pos() - inspection_byte_k;
-                } else // singleton
-                {
-                    branch_data.location_m = make_location(branch_data.bit_count_m);
-                }
-            } else {
-                error_m << "WARNING: I'm not sure what I'm looking at (" << type << ")...\n";
+                // Whatever the name turns out to be, including nothing, it is part of this chain.
+                std::vector<adobe::name_t>& dependents(dependents_m[type->type_name_m]);
+
+                if (std::find(dependents.begin(), dependents.end(), field.type_name_m) ==
+                    dependents.end())
+                    dependents.push_back(field.type_name_m);
+
+                type = find(type->type_name_m);
             }
 
-            if (remote_position) {
-                // restore the position marker if it was tweaked to read this field
-                input_m.seek(position_save);
-            } else {
-                // If it's not a remote position we want to cache the end
-                // offset for this node in its parent. Because the nodes
-                // are in increasing order in the file we overwrite the
-                // end offset with whatever the most current value is.
-                parent->end_offset_m = input_m.pos() - inspection_byte_k;
+            entry.resolved_m = true;
+            entry.atom_m     = type;
+        }
+
+        named = entry.named_m;
+        atom  = entry.atom_m;
+    }
+
+    if (named) {
+        field.type_name_m = named->type_name_m;
+        field.structure_m = named->structure_m;
+    }
+
+    if (atom == 0) {
+        field.kind_m = field_kind_struct_k;
+
+        return field;
+    }
+
+    // we found an atom typedef; we're done.
+    field.kind_m                     = field_kind_atom_k;
+    field.isolated_m                 = field.isolated_m && atom->isolated_m;
+    field.referenced_m               = field.referenced_m || atom->referenced_m;
+    field.base_type_m                = atom->base_type_m;
+    field.bit_count_expression_m     = atom->bit_count_expression_m;
+    field.is_big_endian_expression_m = atom->is_big_endian_expression_m;
+
+    return field;
+}
+
+/****************************************************************************************************/
+
+template <typename T>
+T binspector_analyzer_t::eval_here(const compiled_expression_t& expression) {
+    // Literals were folded when the template was compiled; there is nothing to evaluate.
+    if (expression.is_constant())
+        return expression.constant_value().cast<T>();
+
+    restore_point_t restore_point(input_m);
+
+    // "here" being the current location the file format AST.
+    return contextual_evaluation_of<T>(expression, forest_m->begin(), current_leaf_m, input_m);
+}
+
+// specialization because double doesn't always implicitly convert to boost::uint64_t
+template <>
+boost::uint64_t binspector_analyzer_t::eval_here(const compiled_expression_t& expression) {
+    return static_cast<boost::uint64_t>(eval_here<double>(expression));
+}
+
+/****************************************************************************************************/
+
+template <typename T>
+bool binspector_analyzer_t::eval_here(const compiled_expression_t& expression, T& result) {
+    if (expression.is_constant()) {
+        result = expression.constant_value().cast<T>();
+
+        return true;
+    }
+
+    restore_point_t      restore_point(input_m);
+    bool                 end_of_file(false);
+    adobe::any_regular_t value(contextual_evaluation_of(
+        expression, forest_m->begin(), current_leaf_m, input_m, end_of_file));
+
+    if (end_of_file)
+        return false;
+
+    result = value.cast<T>();
+
+    return true;
+}
+
+template <>
+bool binspector_analyzer_t::eval_here(const compiled_expression_t& expression,
+                                      boost::uint64_t&             result) {
+    double value(0);
+
+    if (!eval_here(expression, value))
+        return false;
+
+    result = static_cast<boost::uint64_t>(value);
+
+    return true;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::signal_end_of_file() {
+    // If this is true then we've reached eof once already and are continuing to
+    // try and read the file. As such be a little more draconian: throw.
+    if (eof_signalled_m)
+        throw std::runtime_error("EOF reached. Consider using the eof slot.");
+
+    // The slot is above the element a worker was given; the element is analyzed again in order.
+    if (worker_m)
+        throw std::runtime_error("EOF reached in an element analyzed out of order.");
+
+    // The analysis around a body expanded on demand is done, and has seen the slot as it was. The
+    // body is within the file (see defer_sentry), so it is the body that is wrong.
+    if (expanding_m)
+        throw std::runtime_error(
+            "EOF reached in a body analyzed on demand; it reads past its sentry.");
+
+    eof_signalled_m = true;
+
+    // Look for the slot where the expression `eof` would find it. Templates without one are
+    // common, so this is a lookup that can miss rather than an evaluation that would throw.
+    inspection_branch_t main(forest_m->begin());
+    inspection_branch_t node(current_leaf_m);
+
+    while (!node.equal_node(inspection_branch_t())) {
+        inspection_branch_t slot(find_child(node, "eof"_name));
+
+        if (!slot.equal_node(inspection_branch_t())) {
+            static const adobe::array_t        true_k(1, adobe::any_regular_t(true));
+            static const compiled_expression_t true_expression_k(true_k);
+
+            signal_slot(slot, true_expression_k);
+
+            return;
+        }
+
+        if (node.equal_node(main))
+            break;
+
+        node = parent_of(node);
+    }
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::signal_slot(inspection_branch_t          slot,
+                                        const compiled_expression_t& expression) {
+    if (incremental_m)
+        signal_log_m.push_back(
+            signal_record_t{&*slot, slot->expression_m, slot->compiled_expression_m});
+
+    // actually update the slot with a new expression and clear the cache
+    slot->expression_m          = expression.source();
+    slot->compiled_expression_m = &expression;
+    slot->evaluated_m           = false;
+}
+
+/****************************************************************************************************/
+
+template <typename T>
+T binspector_analyzer_t::identifier_lookup(adobe::name_t identifier) {
+    adobe::array_t expression;
+
+    expression.push_back(adobe::any_regular_t(identifier));
+    expression.push_back(adobe::any_regular_t(adobe::variable_k));
+
+    return eval_here<T>(compiled_expression_t(expression));
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::set_quiet(bool quiet) {
+    quiet_m = quiet;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::set_parallel(bool parallel) {
+    parallel_m = parallel;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::set_skeleton(bool skeleton) {
+    skeleton_m = skeleton;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::set_streaming(bool streaming) {
+    streaming_m = streaming;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::set_node_stats(bool node_stats) {
+    node_stats_m = node_stats;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::set_lazy(bool lazy) {
+    lazy_m = lazy;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::set_incremental(bool incremental) {
+    incremental_m = incremental;
+}
+
+/****************************************************************************************************/
+
+bool binspector_analyzer_t::analyze_with_structure(const compiled_structure_t& structure,
+                                                   inspection_branch_t         parent) {
+    // Structures nest by pushing frames onto frames_m rather than by recursing, so how deep a file
+    // nests is bounded by the heap and not by the native stack. A field that pushes a frame leaves
+    // the rest of its work pending in its own frame, to be resumed once the new one is done.
+    frame_stack_t::size_type base(frames_m.size());
+
+    push_frame(structure, parent);
+
+    return run_frames(base);
+}
+
+/****************************************************************************************************/
+
+bool binspector_analyzer_t::run_frames(frame_stack_t::size_type base) {
+    std::exception_ptr exception;
+
+    while (frames_m.size() != base) {
+        // main's is the only frame between its fields
+        if (incremental_m && !worker_m && !expanding_m && !exception && frames_m.size() == 1)
+            checkpoint();
+
+        try {
+            // An exception raised while leaving a frame carries on into the frame below it.
+            if (exception) {
+                std::exception_ptr rethrow;
+
+                rethrow.swap(exception);
+
+                std::rethrow_exception(rethrow);
             }
+
+            frame_t& frame(frames_m.back());
+            bool     more(true);
+
+            // Running out of file while placing a field is reported rather than thrown: truncated
+            // files are the common case, not the exception.
+            if (frame.pending_m.kind_m != pending_none_k)
+                more = resume_field(frame);
+            else if (frame.iter_m != frame.structure_m->end())
+                more = analyze_field(frame);
+            else
+                pop_frame();
+
+            if (node_stats_m)
+                peak_node_count_m = std::max(peak_node_count_m, forest_m->size());
+
+            if (!more)
+                end_of_file(exception);
         } catch (const std::out_of_range&) {
-            // eliminate the node that caused the eof; it is invalid.
-            forest_m->erase(sub_branch);
+            // e.g., reading past the end of the file to evaluate an expression
+            end_of_file(exception);
+        } catch (const std::exception& error) {
+            pop_frame();
+
+            error_m << "error: " << error.what() << '\n';
+
+            if (current_leaf_m != inspection_branch_t())
+                error_m << "while analyzing: " << last_path() << '.' << last_name_m << '\n';
+
+            error_m << "in file: " << last_filename_m << ":" << last_line_number_m << '\n';
+
+            // the frames below this one give up, too.
+            while (frames_m.size() != base)
+                pop_frame();
+
+            return false;
+        } catch (...) {
+            while (frames_m.size() != base)
+                pop_frame();
 
-            // rethrow; eof signalling handled elsewhere.
             throw;
         }
     }
 
-    return true;
-} catch (const std::out_of_range&) {
-    // signal eof slot if it is present
-    signal_end_of_file();
+    if (exception)
+        std::rethrow_exception(exception);
 
     return true;
-} catch (const std::exception& error) {
-    error_m << "error: " << error.what() << '\n';
+}
+
+/****************************************************************************************************/
 
-    if (current_leaf_m != inspection_branch_t())
-        error_m << "while analyzing: " << last_path() << '.' << last_name_m << '\n';
+void binspector_analyzer_t::end_of_file(std::exception_ptr& exception) {
+    frame_t& frame(frames_m.back());
+
+    if (frame.pending_m.sub_branch_m != inspection_branch_t()) {
+        // the checkpoints it is open in could not put it back
+        while (!checkpoints_m.empty() &&
+               std::any_of(checkpoints_m.back().open_nodes_m.begin(),
+                           checkpoints_m.back().open_nodes_m.end(),
+                           [&](const open_node_t& node) {
+                               return node.branch_m.equal_node(frame.pending_m.sub_branch_m);
+                           }))
+            checkpoints_m.pop_back();
+
+        // eliminate the node that caused the eof; it is invalid.
+        unindex_child(frame.parent_m, frame.pending_m.sub_branch_m);
+        forest_m->erase(frame.pending_m.sub_branch_m);
+    }
 
-    error_m << "in file: " << last_filename_m << ":" << last_line_number_m << '\n';
+    pop_frame();
 
-    return false;
+    // signal eof slot if it is present. The frame is then done as if it had finished, and the
+    // frame below it picks up where it left off.
+    try {
+        signal_end_of_file();
+    } catch (...) {
+        exception = std::current_exception();
+    }
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::push_frame(const compiled_structure_t& structure,
+                                       inspection_branch_t         parent) {
+    frames_m.push_back(frame_t());
+
+    frame_t& frame(frames_m.back());
+
+    frame.structure_m              = &structure;
+    frame.iter_m                   = structure.begin();
+    frame.parent_m                 = parent;
+    frame.entry_leaf_m             = current_leaf_m;
+    frame.typedef_mark_m           = typedef_scope_m.mark();
+    frame.last_conditional_value_m = false;
+    frame.pending_m.kind_m         = pending_none_k;
+
+    current_leaf_m = parent;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::pop_frame() {
+    frame_t& frame(frames_m.back());
+
+    restore_pending(frame);
+
+    typedef_scope_m.rollback(frame.typedef_mark_m);
+
+    current_leaf_m = frame.entry_leaf_m;
+
+    frames_m.pop_back();
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::restore_pending(frame_t& frame) {
+    pending_t& pending(frame.pending_m);
+
+    switch (pending.kind_m) {
+        case pending_enumerated_k:
+            current_enumerated_value_m      = std::move(pending.saved_enumerated_value_m);
+            current_enumerated_found_m      = pending.saved_enumerated_found_m;
+            current_enumerated_option_set_m = std::move(pending.saved_enumerated_option_set_m);
+            break;
+        case pending_sentry_k:
+            current_sentry_m          = pending.saved_sentry_m;
+            current_sentry_set_path_m = std::move(pending.saved_sentry_set_path_m);
+            break;
+        case pending_node_k:
+        case pending_struct_k:
+        case pending_struct_array_k:
+            current_leaf_m = frame.parent_m;
+            break;
+        default:
+            break;
+    }
+
+    pending.kind_m       = pending_none_k;
+    pending.sub_branch_m = inspection_branch_t();
+}
+
+/****************************************************************************************************/
+
+bool binspector_analyzer_t::analyze_field(frame_t& frame) {
+    const field_descriptor_t& next(*frame.iter_m++);
+
+    // The very first thing we want to do is the typedef resolution. This gives us the ability
+    // to assert that the field is going to be the actual field once the typedef lookup has
+    // completed.
+    if (next.kind_m == field_kind_typedef_atom_k || next.kind_m == field_kind_typedef_named_k) {
+        // add the typedef's field details to the typedef scope; we're done
+        typedef_scope_m.define(next);
+
+        return true;
+    }
+
+    // Here we do the typename lookup if necessary and set the field appropriately.
+    // If the name lookup is not necessary (i.e., we have found any type other than
+    // a named type) then we just use the field pointed to by the current iterator.
+    const field_descriptor_t* field_ptr(&next);
+
+    if (next.kind_m == field_kind_named_k) {
+        frame.resolved_m = typedef_scope_m.resolve(next);
+        field_ptr        = &frame.resolved_m;
+    }
+
+    const field_descriptor_t& field(*field_ptr);
+    adobe::name_t             name(field.name_m);
+    inspection_branch_t       parent(frame.parent_m);
+    pending_t&                pending(frame.pending_m);
+
+    if (worker_m && !field.isolated_m)
+        throw std::runtime_error("Field needs more than the element analyzed out of order.");
+
+    // a named field whose typedef resolves to more than mark_lazy_sentries could see
+    if (expanding_m && !field.isolated_m)
+        throw std::runtime_error("Field needs more than the body analyzed on demand.");
+
+    pending.field_m = &field;
+
+    last_name_m        = name;
+    last_filename_m    = field.filename_m;
+    last_line_number_m = field.line_number_m;
+
+    // if our field is conditional check if condition holds; if not continue past field
+    if (field.conditional_m != none_k) {
+        if (field.conditional_m == else_k) {
+            // if we've already found our true expression in this block skip this one
+            if (frame.last_conditional_value_m)
+                return true;
+
+            frame.last_conditional_value_m = true;
+        } else // conditional_type == if_k
+        {
+            const compiled_expression_t& if_expression(*field.expression_m);
+
+            if (!eval_here(if_expression, frame.last_conditional_value_m))
+                return false;
+        }
+
+        if (frame.last_conditional_value_m) {
+            // jump in to the conditional block but use the same parent as the
+            // on that came in - this will add the conditional block's items
+            // to the parent, flattening out the conditional.
+
+            push_frame(structure_for(field), parent);
+        }
+
+        // we're done with this conditional whether true or false
+        return true;
+    }
+
+    switch (field.kind_m) {
+        case field_kind_invariant_k: {
+            const compiled_expression_t& expression(*field.expression_m);
+            bool                         holds(false);
+
+            if (!eval_here(expression, holds))
+                return false;
+
+            if (!holds)
+                throw std::runtime_error(
+                    adobe::make_string("invariant '", name.c_str(), "' failed to hold."));
+
+            return true;
+        }
+        case field_kind_enumerated_k: {
+            const compiled_expression_t& branch_expression(*field.expression_m);
+            inspection_branch_t  atom(eval_here<inspection_branch_t>(branch_expression));
+            adobe::any_regular_t value;
+
+            {
+                restore_point_t restore_point(input_m);
+
+                value =
+                    finalize_lookup<adobe::any_regular_t>(forest_m->begin(), atom, input_m, true);
+            }
+
+            pending.kind_m                        = pending_enumerated_k;
+            pending.atom_m                        = atom;
+            pending.option_m                      = 0;
+            pending.saved_enumerated_value_m      = std::move(current_enumerated_value_m);
+            pending.saved_enumerated_found_m      = current_enumerated_found_m;
+            pending.saved_enumerated_option_set_m = std::move(current_enumerated_option_set_m);
+
+            current_enumerated_value_m      = std::move(value);
+            current_enumerated_found_m      = false;
+            current_enumerated_option_set_m = adobe::array_t();
+
+            if (field.enumeration_m) {
+                // Every option is a number, so only a number can match one.
+                const enumeration_t&      enumeration(*field.enumeration_m);
+                const field_descriptor_t* option(enumeration.default_m);
+
+                if (current_enumerated_value_m.type_info() == typeid(double)) {
+                    enumeration_t::option_map_t::const_iterator found(
+                        enumeration.option_map_m.find(current_enumerated_value_m.cast<double>()));
+
+                    if (found != enumeration.option_map_m.end())
+                        option = found->second;
+                }
+
+                if (option) {
+                    pending.option_m = option;
+
+                    push_frame(structure_for(*option), parent);
+
+                    return true;
+                }
+            } else {
+                push_frame(structure_for(field), parent);
+
+                return true;
+            }
+
+            finish_enumerated(frame);
+
+            return true;
+        }
+        case field_kind_enumerated_option_k: {
+            const compiled_expression_t& expression(*field.expression_m);
+            adobe::any_regular_t option_value(eval_here<adobe::any_regular_t>(expression));
+
+            current_enumerated_option_set_m.push_back(option_value);
+
+            if (option_value == current_enumerated_value_m) {
+                pending.kind_m = pending_enumerated_option_k;
+
+                push_frame(structure_for(field), parent);
+            }
+
+            return true;
+        }
+        case field_kind_enumerated_default_k: {
+            if (!current_enumerated_found_m) {
+                pending.kind_m = pending_enumerated_option_k;
+
+                push_frame(structure_for(field), parent);
+            }
+
+            return true;
+        }
+        case field_kind_sentry_k: {
+            bitreader_t::pos_t sentry_position(sentry_position_for(field));
+
+            if (lazy_m && field.lazy_m && !worker_m && !expanding_m &&
+                defer_sentry(parent, field, sentry_position))
+                return true;
+
+            const compiled_structure_t& structure(structure_for(field));
+            std::string                 sentry_set_path(last_path());
+
+            pending.kind_m                  = pending_sentry_k;
+            pending.sentry_position_m       = sentry_position;
+            pending.saved_sentry_m          = current_sentry_m;
+            pending.saved_sentry_set_path_m = std::move(current_sentry_set_path_m);
+
+            current_sentry_m          = sentry_position;
+            current_sentry_set_path_m = std::move(sentry_set_path);
+
+            // std::cerr << "! sentry set to " << sentry_position << '\n';
+
+            push_frame(structure, parent);
+
+            return true;
+        }
+        case field_kind_notify_k: {
+            // REVISIT (fbrereto) : Refactor and unify this code with value_field_type_summary
+
+            if (quiet_m)
+                return true;
+
+            const compiled_expression_t& expression(*field.expression_m);
+            adobe::array_t               argument_set(eval_here<adobe::array_t>(expression));
+            std::stringstream            result;
+
+            adobe::copy(argument_set, std::ostream_iterator<adobe::any_regular_t>(result));
+
+            output_m << result.str() << '\n';
+
+            return true;
+        }
+        case field_kind_summary_k: {
+            // REVISIT (fbrereto) : Refactor and unify this code with value_field_type_notify
+
+            if (quiet_m)
+                return true;
+
+            parent->summary_m.clear();
+            parent->summary_expression_m = field.expression_m;
+            parent->set_flag(is_summary_rendered_k, false);
+
+            // Rendered only if asked for (see summary_of), unless it would not come out the same
+            // then: a name found above the struct now could be found in it by then.
+            if (!field.pure_m || !names_found_in(*field.expression_m, parent))
+                summary_of(forest_m->begin(), parent, input_m);
+
+            return true;
+        }
+        case field_kind_die_k: {
+            const compiled_expression_t& expression(*field.expression_m);
+            adobe::array_t               argument_set(eval_here<adobe::array_t>(expression));
+            std::stringstream            result;
+
+            result << "die: ";
+
+            adobe::copy(argument_set, std::ostream_iterator<adobe::any_regular_t>(result));
+
+            throw std::runtime_error(result.str());
+        }
+        case field_kind_signal_k: {
+            signal_slot(identifier_lookup<inspection_branch_t>(name), *field.expression_m);
+
+            return true;
+        }
+        default:
+            break;
+    }
+
+    // Nothing will look the field up, so all it needs is to be placed.
+    if (skeleton_m && !field.referenced_m) {
+        switch (field.kind_m) {
+            case field_kind_const_k:
+            case field_kind_slot_k:
+                return true;
+            case field_kind_atom_k:
+            case field_kind_skip_k:
+                if (field.size_type_m == field_size_none_k && field.offset_expression_m->empty())
+                    return place_field(frame, field);
+
+                break;
+            default:
+                break;
+        }
+    }
+
+    // !!!!! NOTICE !!!!!
+    //
+    // From this point on we've actually added a node to the analysis forest.
+    // So if you want to do anything during analysis without affecting the
+    // forest, do it above this comment. (Also, make sure this comment stays
+    // with the sub_branch creation so we have something obvious to demarcate
+    // when a node is added to the forest.)
+
+    inspection_branch_t sub_branch(new_branch(parent, name));
+    forest_node_t&      branch_data(*sub_branch);
+
+    // Should we hit the end of the file from here on, the node is erased (see
+    // analyze_with_structure).
+    pending.kind_m       = pending_node_k;
+    pending.sub_branch_m = sub_branch;
+
+    current_leaf_m = sub_branch;
+
+    if (field.kind_m == field_kind_struct_k)
+        branch_data.set_flag(type_struct_k);
+    else if (field.kind_m == field_kind_atom_k)
+        branch_data.set_flag(type_atom_k);
+    else if (field.kind_m == field_kind_const_k)
+        branch_data.set_flag(type_const_k);
+    else if (field.kind_m == field_kind_skip_k)
+        branch_data.set_flag(type_skip_k);
+    else if (field.kind_m == field_kind_slot_k)
+        branch_data.set_flag(type_slot_k);
+    else
+        throw std::runtime_error("analysis error: unknown field kind");
+
+    if (field.kind_m == field_kind_const_k) {
+        branch_data.expression_m          = field.expression_m->source();
+        branch_data.compiled_expression_m = field.expression_m;
+        branch_data.no_print_m            = field.no_print_m;
+
+        restore_pending(frame);
+
+        return true;
+    } else if (field.kind_m == field_kind_skip_k) {
+        // skip is different in that its parameter is unit BYTES not bits
+        const compiled_expression_t& skip_expression(*field.expression_m);
+        boost::uint64_t              byte_count(0);
+
+        if (!eval_here(skip_expression, byte_count))
+            return false;
+
+        branch_data.start_offset_m = input_m.pos();
+
+        if (parent->start_offset_m == invalid_position_k)
+            parent->start_offset_m = input_m.pos();
+
+        // skip the bytes here
+        branch_data.bit_count_m = byte_count * 8;
+        branch_data.location_m  = make_location(branch_data.bit_count_m);
+
+        if (branch_data.location_m == invalid_position_k)
+            return false;
+
+        branch_data.end_offset_m = input_m.pos() - inspection_byte_k;
+        parent->end_offset_m     = branch_data.end_offset_m;
+
+        restore_pending(frame);
+
+        return true;
+    } else if (field.kind_m == field_kind_slot_k) {
+        branch_data.expression_m          = field.expression_m->source();
+        branch_data.compiled_expression_m = field.expression_m;
+
+        restore_pending(frame);
+
+        return true;
+    }
+
+    field_size_t                 field_size_type(field.size_type_m);
+    bool                         has_size_expression(field_size_type != field_size_none_k);
+    const compiled_expression_t& field_size_expression(*field.size_expression_m);
+
+    if (has_size_expression) {
+        branch_data.set_flag(is_array_root_k);
+        branch_data.cardinal_m = 0; // loops will overwrite
+        branch_data.shuffle_m  = field.shuffle_m;
+    }
+
+    const compiled_expression_t& offset_expression(*field.offset_expression_m);
+
+    pending.position_save_m   = input_m.pos();
+    pending.remote_position_m = !offset_expression.empty();
+
+    if (pending.remote_position_m) {
+        // if our field's data is not at the next immediate offset,
+        // temporarily set the position marker to that offset location
+        // and restore it later.
+        adobe::any_regular_t  offset_value;
+        inspection_position_t offset;
+
+        if (!eval_here(offset_expression, offset_value))
+            return false;
+
+        if (offset_value.type_info() == typeid(double))
+            offset = bytepos(offset_value.cast<double>());
+        else if (offset_value.type_info() == typeid(inspection_position_t))
+            offset = offset_value.cast<inspection_position_t>();
+        else
+            throw std::runtime_error("Expected a position or a double for the offset");
+
+        input_m.seek(offset);
+    } else {
+        // If it's not a remote position we want to cache the start
+        // offset for this node in its parent, but only if it hasn't
+        // already been set.
+        if (parent->start_offset_m == invalid_position_k)
+            parent->start_offset_m = input_m.pos();
+    }
+
+    if (field.kind_m == field_kind_struct_k) {
+        branch_data.struct_name_m = field.type_name_m;
+
+        if (has_size_expression) {
+            // a loop means branch_data is an array root, so we must
+            // update the start and end offset for it.
+            branch_data.start_offset_m = input_m.pos();
+            branch_data.end_offset_m   = input_m.pos();
+
+            if (field_size_type == field_size_while_k) {
+                // the predicate is evaluated before each element; see next_struct_element.
+            } else if (field_size_type == field_size_integer_k) {
+                double size_count_double(0);
+
+                if (!eval_here(field_size_expression, size_count_double))
+                    return false;
+
+                if (size_count_double < 0)
+                    throw std::runtime_error("Negative bounds size for array");
+
+                pending.size_count_m = static_cast<std::size_t>(size_count_double);
+            } else if (field_size_type == field_size_terminator_k) {
+                throw std::runtime_error("Structure size expression: terminator not allowed");
+            } else if (field_size_type == field_size_delimiter_k) {
+                if (!eval_here(field_size_expression, pending.delimiter_m))
+                    return false;
+
+                pending.delimiter_byte_count_m =
+                    std::max<std::size_t>(1, highest_byte_for(pending.delimiter_m));
+            } else {
+                throw std::runtime_error("Unknown structure size expression type");
+            }
+
+            pending.kind_m = pending_struct_array_k;
+
+            // As many elements as can be are analyzed ahead; the rest are left to the loop.
+            bool complete(parallel_m && speculate_array(frame));
+
+            if (!complete && next_struct_element(frame))
+                return true;
+
+            // One final update to the root's end offset should does the trick
+            branch_data.end_offset_m = input_m.pos() - inspection_byte_k;
+        } else // singleton
+        {
+            pending.kind_m = pending_struct_k;
+
+            push_frame(structure_for(field), sub_branch);
+
+            return true;
+        }
+    } else if (field.kind_m == field_kind_atom_k) {
+        const compiled_expression_t& bit_count_expression(*field.bit_count_expression_m);
+        const compiled_expression_t& is_big_endian_expression(*field.is_big_endian_expression_m);
+        bool                         is_big_endian(false);
+
+        if (!eval_here(is_big_endian_expression, is_big_endian) ||
+            !eval_here(bit_count_expression, branch_data.bit_count_m))
+            return false;
+
+        branch_data.type_m = field.base_type_m;
+        branch_data.set_flag(atom_is_big_endian_k, is_big_endian);
+
+        if (has_size_expression) {
+            // a loop means branch_data is an array root, so we must
+            // update the start and end offset for it.
+            branch_data.start_offset_m = input_m.pos();
+            branch_data.end_offset_m   = input_m.pos();
+
+            // The elements of an atom array are not given nodes of their own; the root
+            // stands in for all of them (see array_element).
+            branch_data.set_flag(is_implicit_array_k);
+            branch_data.forest_m   = forest_m.get();
+            branch_data.location_m = input_m.pos();
+
+            if (field_size_type == field_size_delimiter_k) {
+                /*
+                    The delimiter need not be aligned to the element size; e.g., a 16-bit
+                    delimiter can start on any byte. So rather than reading elements and
+                    comparing them, the bytes of the delimiter are searched for directly.
+                    The template can promise the delimiter only ever starts some multiple
+                    of bytes into the array (e.g., [delimiter: 0xFFD9, align: 2]), in which
+                    case only those offsets are compared.
+                */
+                boost::uint64_t delimiter(eval_here<boost::uint64_t>(field_size_expression));
+                std::size_t     delimiter_byte_count(
+                    std::max<std::size_t>(1, highest_byte_for(delimiter)));
+                const compiled_expression_t& alignment_expression(*field.alignment_expression_m);
+                double                       alignment(alignment_expression.empty() ?
+                                                           1 :
+                                                           eval_here<double>(alignment_expression));
+                boost::uint8_t               pattern[sizeof(boost::uint64_t)];
+
+                if (alignment < 1)
+                    throw std::runtime_error("Delimiter alignment must be at least 1");
+
+                store_endian(delimiter, &pattern[0], true);
+
+                // the delimiter's bytes are the low ones of the big-endian value.
+                boost::uint64_t running_count(
+                    input_m.find(&pattern[sizeof(pattern) - delimiter_byte_count],
+                                 delimiter_byte_count,
+                                 static_cast<std::size_t>(alignment)));
+
+                if (running_count == bitreader_t::not_found_k ||
+                    make_array_location(branch_data.bit_count_m, running_count) ==
+                        invalid_position_k)
+                    return false;
+
+                branch_data.cardinal_m = running_count;
+            } else if (field_size_type == field_size_terminator_k) {
+                boost::uint64_t terminator(eval_here<boost::uint64_t>(field_size_expression));
+                std::size_t     read_size(
+                    static_cast<std::size_t>(bytesize(branch_data.bit_count_m)));
+                boost::uint8_t read_size_leftovers(bitsize(branch_data.bit_count_m));
+                boost::uint8_t pattern[sizeof(boost::uint64_t)];
+
+                if (read_size_leftovers)
+                    throw std::runtime_error(
+                        "Use of non-byte-aligned fields with a terminator not supported.");
+
+                if (read_size == 0)
+                    throw std::runtime_error(
+                        "Use of empty fields with a terminator not supported.");
+
+                if (read_size > 8)
+                    throw std::runtime_error("Use of terminators > 64 bits not supported.");
+
+                // A terminator too wide for the element type could never be read, so we
+                // would hit the end of the file looking for it.
+                if (highest_byte_for(terminator) > read_size)
+                    return false;
+
+                // The terminator is compared as a value of the element type: search for
+                // its bytes in the element's byte order at element boundaries only.
+                store_endian(terminator, &pattern[0], is_big_endian);
+
+                const boost::uint8_t* element(
+                    is_big_endian ? &pattern[sizeof(pattern) - read_size] : &pattern[0]);
+                boost::uint64_t found(input_m.find(element, read_size, read_size));
+
+                if (found == bitreader_t::not_found_k)
+                    return false;
+
+                boost::uint64_t running_count(found / read_size + 1);
+
+                if (make_array_location(branch_data.bit_count_m, running_count) ==
+                    invalid_position_k)
+                    return false;
+
+                branch_data.cardinal_m = running_count;
+            } else if (field_size_type == field_size_while_k) {
+                bool more(false);
+
+                while (true) {
+                    if (!eval_here(field_size_expression, more))
+                        return false;
+
+                    if (!more)
+                        break;
+
+                    if (make_location(branch_data.bit_count_m) == invalid_position_k)
+                        return false;
+
+                    ++branch_data.cardinal_m;
+                }
+            } else if (field_size_type == field_size_integer_k) {
+                double size_count_double(0);
+
+                if (!eval_here(field_size_expression, size_count_double))
+                    return false;
+
+                if (size_count_double < 0)
+                    throw std::runtime_error("Negative bounds size for array");
+
+                std::size_t size_count(static_cast<std::size_t>(size_count_double));
+
+                if (make_array_location(branch_data.bit_count_m, size_count) ==
+                    invalid_position_k)
+                    return false;
+
+                branch_data.cardinal_m = size_count;
+            } else {
+                throw std::runtime_error("Unknown atom size expression type");
+            }
+
+            // One final update to the root's end offset should does the trick
+            branch_data.end_offset_m = input_m.pos() - inspection_byte_k;
+        } else // singleton
+        {
+            branch_data.location_m = make_location(branch_data.bit_count_m);
+
+            if (branch_data.location_m == invalid_position_k)
+                return false;
+        }
+    } else {
+        error_m << "WARNING: I'm not sure what I'm looking at (kind " << field.kind_m << ")...\n";
+    }
+
+    finish_node(frame);
+
+    return true;
+}
+
+/****************************************************************************************************/
+
+bool binspector_analyzer_t::resume_field(frame_t& frame) {
+    pending_t& pending(frame.pending_m);
+
+    switch (pending.kind_m) {
+        case pending_enumerated_k:
+            finish_enumerated(frame);
+            break;
+        case pending_enumerated_option_k:
+            current_enumerated_found_m = true;
+
+            restore_pending(frame);
+            break;
+        case pending_sentry_k: {
+            bitreader_t::pos_t sentry_position(pending.sentry_position_m);
+
+            restore_pending(frame);
+
+            // Now we check to see not if we've gone beyond the sentry
+            // but instead haven't reached it (e.g., we were told the
+            // size would be 100 bytes but only analyzed 99.) While this
+            // isn't necessarily fatal (hence the warning and not an
+            // error) it may point to errors in the template definition.
+            if (input_m.pos() != sentry_position) {
+                error_m << "WARNING: After " << current_sentry_set_path_m
+                        << " sentry, read position should be " << sentry_position
+                        << " but instead is " << input_m.pos() << ".";
+
+#if 0
+                error_m << " Position forced!";
+
+                // In the event the sentry is violated, put the read head
+                // where it is expected. This will give us our best chance
+                // at being able to continue reading the file without
+                // further issue. This means we're trusting the length
+                // prefixes in a document more than the actual data that's
+                // in there, which is philosophically debatable, I'm sure.
+                input_m.seek(sentry_position);
+#endif
+
+                error_m << '\n';
+            }
+        } break;
+        case pending_struct_k:
+            finish_node(frame);
+            break;
+        case pending_struct_array_k: {
+            forest_node_t& branch_data(*pending.sub_branch_m);
+
+            // We keep the end offset up to date because it
+            // may be used by the while predicate
+            if (pending.field_m->size_type_m == field_size_while_k)
+                branch_data.end_offset_m = input_m.pos() - inspection_byte_k;
+
+            // The elements done so far go now rather than with the root; see finish_node.
+            // Of those something could look up, the one just done keeps what is looked up late.
+            if (streaming_m && !incremental_m && !pending.field_m->elements_referenced_m)
+                erase_children_after(*forest_m, pending.sub_branch_m, inspection_branch_t());
+            else if (streaming_m && !incremental_m && !lazy_m &&
+                     adobe::has_children(pending.sub_branch_m))
+                drop_local_children(last_child_of(pending.sub_branch_m));
+
+            if (next_struct_element(frame))
+                return true;
+
+            // One final update to the root's end offset should does the trick
+            branch_data.end_offset_m = input_m.pos() - inspection_byte_k;
+
+            finish_node(frame);
+        } break;
+        default:
+            restore_pending(frame);
+            break;
+    }
+
+    return true;
+}
+
+/****************************************************************************************************/
+
+bool binspector_analyzer_t::place_field(frame_t& frame, const field_descriptor_t& field) {
+    inspection_branch_t parent(frame.parent_m);
+    boost::uint64_t     bit_count(0);
+
+    // skip is different in that its parameter is unit BYTES not bits.
+    if (field.kind_m == field_kind_skip_k) {
+        if (!eval_here(*field.expression_m, bit_count))
+            return false;
+
+        bit_count *= 8;
+    } else {
+        // An atom's byte order only matters to reading it, but it is evaluated all the same, as
+        // analyze_field would: a template whose byte order can't be worked out fails validation.
+        // (Most are literals, folded when the template was compiled.)
+        bool is_big_endian(false);
+
+        if (!eval_here(*field.is_big_endian_expression_m, is_big_endian) ||
+            !eval_here(*field.bit_count_expression_m, bit_count))
+            return false;
+    }
+
+    if (parent->start_offset_m == invalid_position_k)
+        parent->start_offset_m = input_m.pos();
+
+    if (make_location(bit_count) == invalid_position_k)
+        return false;
+
+    parent->end_offset_m = input_m.pos() - inspection_byte_k;
+
+    return true;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::finish_enumerated(frame_t& frame) {
+    pending_t&                pending(frame.pending_m);
+    const field_descriptor_t& field(*pending.field_m);
+    inspection_branch_t       atom(pending.atom_m);
+
+    if (field.enumeration_m) {
+        if (pending.option_m)
+            current_enumerated_found_m = true;
+
+        current_enumerated_option_set_m = field.enumeration_m->option_set_m;
+    }
+
+    if (current_enumerated_found_m) {
+        if (!atom->option_set_m.empty()) {
+            // This warning may need to be more clear, as its not
+            // last_path_m that is the cause of the warning but the
+            // option_set_m within the atom. (last_path() is the line
+            // in the code that caused the warning.)
+
+            error_m << "WARNING: " << build_path(atom) << " has multiple enumerate sets!\n";
+        }
+
+        // This stores within the enumerated node all the possible options
+        // found in the AST. This will give the fuzzer a set of valid options
+        // with which it can tweak this value and otherwise wreak smart
+        // havoc with the file format.
+
+        atom->option_set_m = current_enumerated_option_set_m;
+    } else {
+        std::string error;
+
+        // REVISIT (fbrereto) : We have to have a cleaner solution than
+        //                      this kind of concatenation...
+        error += "value for " + build_path(atom) + " is not enumerated (" +
+                 serialize(current_enumerated_value_m) + ")";
+
+        throw std::runtime_error(error);
+    }
+
+    restore_pending(frame);
+}
+
+/****************************************************************************************************/
+
+bool binspector_analyzer_t::more_struct_elements(frame_t& frame) {
+    pending_t&                pending(frame.pending_m);
+    const field_descriptor_t& field(*pending.field_m);
+
+    if (field.size_type_m == field_size_while_k)
+        return eval_here<bool>(*field.size_expression_m);
+
+    if (field.size_type_m == field_size_integer_k)
+        return pending.sub_branch_m->cardinal_m != pending.size_count_m;
+
+    // field_size_delimiter_k
+    boost::uint64_t delimiter_peek(0);
+
+    {
+        restore_point_t restore_point(input_m);
+
+        delimiter_peek = input_m.read_uint(pending.delimiter_byte_count_m * 8, true);
+    }
+
+    return delimiter_peek != pending.delimiter_m;
+}
+
+/****************************************************************************************************/
+
+bool binspector_analyzer_t::next_struct_element(frame_t& frame) {
+    if (!more_struct_elements(frame))
+        return false;
+
+    const compiled_structure_t& structure(structure_for(*frame.pending_m.field_m));
+
+    push_frame(structure, new_array_element(frame.pending_m.sub_branch_m));
+
+    return true;
+}
+
+/****************************************************************************************************/
+
+bitreader_t::pos_t binspector_analyzer_t::sentry_position_for(const field_descriptor_t& field) {
+    const compiled_expression_t& expression(*field.expression_m);
+    adobe::any_regular_t         sentry_value(eval_here<adobe::any_regular_t>(expression));
+
+    // Values of type double are relative to the current input position;
+    // values of type pos_t are absolute.
+
+    if (sentry_value.type_info() == typeid(double))
+        return input_m.pos() + bytepos(sentry_value.cast<double>());
+    else if (sentry_value.type_info() == typeid(bitreader_t::pos_t))
+        return sentry_value.cast<bitreader_t::pos_t>();
+
+    throw std::runtime_error("Unexpected sentry type");
+}
+
+/****************************************************************************************************/
+/*
+    With set_lazy, the body of a sentry is skipped rather than analyzed: the node it would go into
+    is given an expansion, and analysis carries on from the sentry. The body is analyzed the first
+    time anything looks inside the node -- a lookup of a name the node does not have yet, its
+    summary, or a command of the interface -- with the typedefs that were in scope here.
+
+    Only bodies that need nothing past the node they go into are left (see mark_lazy_sentries), and
+    they are trusted to end at their sentry, as the length prefixes of most formats can be. One that
+    does not is warned about once it is analyzed.
+*/
+bool binspector_analyzer_t::defer_sentry(inspection_branch_t       parent,
+                                         const field_descriptor_t& sentry,
+                                         bitreader_t::pos_t        sentry_position) {
+    inspection_position_t position(input_m.pos());
+
+    // one body to a node, and one that is in the file
+    if (parent->expansion_m || sentry_position < position || sentry_position > input_m.size())
+        return false;
+
+    std::shared_ptr<deferred_body_t> body(std::make_shared<deferred_body_t>());
+
+    body->analyzer_m           = this;
+    body->forest_m             = forest_m.get();
+    body->structure_m          = &structure_for(sentry);
+    body->position_m           = position;
+    body->sentry_position_m    = sentry_position;
+    body->typedef_scope_m      = typedef_snapshot();
+    body->last_header_m        = last_child_of(parent);
+    body->summary_expression_m = parent->summary_expression_m;
+
+    // A body that reads anything leaves the node ending at the sentry.
+    if (position < sentry_position) {
+        if (parent->start_offset_m == invalid_position_k)
+            parent->start_offset_m = position;
+
+        parent->end_offset_m = sentry_position - inspection_byte_k;
+    }
+
+    parent->expansion_m = body;
+
+    input_m.seek(sentry_position);
+
+    return true;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::expand_body(inspection_branch_t branch, const deferred_body_t& body) {
+    // Once analysis is done the output streams are, too; whoever is looking gets the messages.
+    bool              late(frames_m.empty());
+    forest_loan_t     loan(forest_m, body.forest_m);
+    stream_redirect_t output(output_m, late ? std::cerr : output_m);
+    stream_redirect_t error(error_m, late ? std::cerr : error_m);
+
+    // The analysis this interrupts, if any, picks up where it was.
+    inspection_position_t        position(input_m.pos());
+    inspection_branch_t          leaf(current_leaf_m);
+    bitreader_t::pos_t           sentry(current_sentry_m);
+    std::string                  sentry_set_path(std::move(current_sentry_set_path_m));
+    typedef_scope_t              typedef_scope(std::move(typedef_scope_m));
+    bool                         expanding(expanding_m);
+    inspection_position_t        start_offset(branch->start_offset_m);
+    inspection_position_t        end_offset(branch->end_offset_m);
+    const compiled_expression_t* summary_expression(branch->summary_expression_m);
+    std::string                  summary(branch->summary_m);
+    bool                         summary_rendered(branch->get_flag(is_summary_rendered_k));
+    inspection_branch_t          last_trailer(last_child_of(branch));
+
+    input_m.seek(body.position_m);
+
+    current_leaf_m            = branch;
+    current_sentry_m          = body.sentry_position_m;
+    current_sentry_set_path_m = last_path();
+    typedef_scope_m           = typedef_scope_t(body.typedef_scope_m);
+    expanding_m               = true;
+
+    if (analyze_with_structure(*body.structure_m, branch) &&
+        input_m.pos() != body.sentry_position_m)
+        error_m << "WARNING: After " << current_sentry_set_path_m
+                << " sentry, read position should be " << body.sentry_position_m
+                << " but instead is " << input_m.pos() << ".\n";
+
+    // The body went in after the trailer; it belongs between the header and the trailer.
+    inspection_forest_t::child_iterator first_body(
+        last_trailer.equal_node(inspection_branch_t()) ?
+            adobe::child_begin(branch) :
+            std::next(inspection_forest_t::child_iterator(last_trailer)));
+    inspection_forest_t::child_iterator first_trailer(
+        body.last_header_m.equal_node(inspection_branch_t()) ?
+            adobe::child_begin(branch) :
+            std::next(inspection_forest_t::child_iterator(body.last_header_m)));
+
+    if (first_body != adobe::child_end(branch) && first_trailer != first_body) {
+        forest_m->splice(first_trailer.base(), *forest_m, first_body, adobe::child_end(branch));
+
+        reindex_children(branch);
+    }
+
+    // unless the trailer had a summary of its own
+    if (summary_expression != body.summary_expression_m) {
+        branch->summary_m            = std::move(summary);
+        branch->summary_expression_m = summary_expression;
+        branch->set_flag(is_summary_rendered_k, summary_rendered);
+    }
+
+    branch->start_offset_m = start_offset;
+    branch->end_offset_m   = end_offset;
+
+    input_m.seek(position);
+
+    current_leaf_m            = leaf;
+    current_sentry_m          = sentry;
+    current_sentry_set_path_m = std::move(sentry_set_path);
+    typedef_scope_m           = std::move(typedef_scope);
+    expanding_m               = expanding;
+}
+
+/****************************************************************************************************/
+/*
+    Length-prefixed elements (e.g., PNG chunks) say where they end before their body is read: the
+    sentry around the body is given by the fields before it. So with --parallel, the fields of each
+    element around its sentry are analyzed here, in order, and the body itself is handed to a worker
+    on the default executor. The worker has a copy of the element and its header as the whole of
+    its forest, and once the bodies before it are in, its body is spliced into the element.
+
+    Anything that needs more than that -- a signal or notification, main, the eof slot, a name from
+    above the element, a message of any kind, or a body that did not end at its sentry -- rolls the
+    array back to the start of that element. It and the rest of the array are then analyzed in order
+    as usual.
+*/
+bool binspector_analyzer_t::speculate_array(frame_t& frame) {
+    pending_t&                  pending(frame.pending_m);
+    const field_descriptor_t&   field(*pending.field_m);
+    const compiled_structure_t& structure(structure_for(field));
+    inspection_branch_t         root(pending.sub_branch_m);
+
+    // workers read the binary at the same time, which only a mapping allows.
+    if (!input_m.mapped())
+        return false;
+
+    compiled_structure_t::const_iterator split(structure.end());
+
+    for (compiled_structure_t::const_iterator iter(structure.begin()); iter != structure.end();
+         ++iter) {
+        if (split == structure.end() && iter->kind_m == field_kind_sentry_k &&
+            iter->conditional_m == none_k)
+            split = iter;
+        else if (!is_framing_field(*iter))
+            return false;
+    }
+
+    if (split == structure.end())
+        return false;
+
+    // Whatever is evaluated once the body is out must not look for anything the body adds: it
+    // would find nothing, or worse, the same name further up. That is the trailer, and the header's
+    // consts and slots, which the trailer may evaluate.
+    std::vector<adobe::name_t> body_names(flattened_names(structure_for(*split)));
+
+    for (compiled_structure_t::const_iterator iter(structure.begin()); iter != structure.end();
+         ++iter) {
+        bool evaluated_late(iter < split ? iter->kind_m == field_kind_const_k ||
+                                               iter->kind_m == field_kind_slot_k :
+                                           iter > split);
+
+        if (evaluated_late && uses_any(*iter, body_names))
+            return false;
+    }
+
+    const std::size_t window(std::max<std::size_t>(2, 2 * std::thread::hardware_concurrency()));
+    speculation_t     speculation;
+    bool              complete(false);
+
+    {
+        // A message stops the speculation: the element it came from is analyzed again in order,
+        // and says it again.
+        stream_hold_t held(error_m);
+
+        while (true) {
+            // Only so many bodies are kept in flight; the oldest are spliced in to make room.
+            while (speculation.size() >= window && commit_body(speculation.front()))
+                speculation.pop_front();
+
+            if (speculation.size() >= window)
+                break;
+
+            speculation.push_back(speculated_element_t());
+
+            speculated_element_t& element(speculation.back());
+
+            element.index_m           = root->cardinal_m;
+            element.position_m        = input_m.pos();
+            element.root_end_offset_m = root->end_offset_m;
+            element.failed_m          = false;
+            element.deferred_m        = false;
+
+            try {
+                complete = !more_struct_elements(frame);
+            } catch (const std::runtime_error&) {
+                // e.g., the predicate needs a body that is still out
+                element.failed_m = true;
+
+                break;
+            } catch (const std::out_of_range&) {
+                // e.g., the predicate reads past the end of the file
+                element.failed_m = true;
+
+                break;
+            }
+
+            if (complete) {
+                speculation.pop_back();
+
+                break;
+            }
+
+            if (!speculate_element(root, structure, split, element) || !held.empty()) {
+                element.failed_m = true;
+
+                break;
+            }
+
+            // the while predicate may use the root's end offset; see resume_field.
+            if (field.size_type_m == field_size_while_k)
+                root->end_offset_m = input_m.pos() - inspection_byte_k;
+        }
+    }
+
+    // Every body is waited on, wanted or not, before the analysis moves on.
+    bool rolled_back(false);
+
+    for (auto& element : speculation) {
+        if (!rolled_back && !element.failed_m && commit_body(element))
+            continue;
+
+        if (element.deferred_m)
+            stlab::blocking_get(element.body_m);
+
+        if (!rolled_back)
+            roll_back(root, element);
+
+        rolled_back = true;
+    }
+
+    return complete && !rolled_back;
+}
+
+/****************************************************************************************************/
+
+bool binspector_analyzer_t::speculate_element(inspection_branch_t                  root,
+                                              const compiled_structure_t&          structure,
+                                              compiled_structure_t::const_iterator split,
+                                              speculated_element_t&                element) {
+    element.element_m = new_array_element(root);
+
+    push_frame(structure, element.element_m);
+
+    frame_t& frame(frames_m.back());
+    bool     result(true);
+
+    try {
+        while (result && frame.iter_m != structure.end()) {
+            if (frame.iter_m == split) {
+                ++frame.iter_m;
+
+                defer_body(*split, element);
+            } else if (frame.iter_m->kind_m == field_kind_named_k &&
+                       typedef_scope_m.resolve(*frame.iter_m).kind_m != field_kind_atom_k) {
+                result = false;
+            } else {
+                result = analyze_field(frame);
+            }
+        }
+    } catch (const std::runtime_error&) {
+        // e.g., a field needs more than the element; it is analyzed again in order.
+        result = false;
+    } catch (const std::out_of_range&) {
+        result = false;
+    }
+
+    pop_frame();
+
+    return result;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::defer_body(const field_descriptor_t& sentry,
+                                       speculated_element_t&     element) {
+    inspection_branch_t         branch(element.element_m);
+    inspection_position_t       position(input_m.pos());
+    bitreader_t::pos_t          sentry_position(sentry_position_for(sentry));
+    const compiled_structure_t* body(&structure_for(sentry));
+    std::string                 sentry_set_path(last_path());
+
+    element.messages_m = std::make_shared<std::stringstream>();
+    element.worker_m.reset(new binspector_analyzer_t(*this, *element.messages_m));
+
+    // The worker's forest is a copy of the array root holding a copy of the element and its header.
+    inspection_forest_t& forest(*element.worker_m->forest_m);
+    inspection_branch_t  root(
+        forest.insert(forest.begin(), detached_copy(*parent_of(branch), forest)));
+    inspection_branch_t  copy(append_copy(forest, root, *branch));
+
+    table_element(root, copy);
+
+    element.header_count_m = 0;
+
+    for (inspection_forest_t::child_iterator iter(adobe::child_begin(branch)),
+         last(adobe::child_end(branch));
+         iter != last;
+         ++iter, ++element.header_count_m) {
+        // counted afresh, and added to the original's count; see commit_body
+        append_copy(forest, copy, *iter)->use_count_m = 0;
+    }
+
+    // A body that reads anything leaves the element ending at the sentry, which the rest of the
+    // array can see before the body is in. commit_body checks the body agrees.
+    element.start_offset_m       = branch->start_offset_m;
+    element.end_offset_m         = branch->end_offset_m;
+    element.summary_expression_m = branch->summary_expression_m;
+
+    if (position < sentry_position) {
+        if (element.start_offset_m == invalid_position_k)
+            element.start_offset_m = position;
+
+        element.end_offset_m = sentry_position - inspection_byte_k;
+    }
+
+    branch->start_offset_m = element.start_offset_m;
+    branch->end_offset_m   = element.end_offset_m;
+
+    std::shared_ptr<binspector_analyzer_t> worker(element.worker_m);
+
+    element.body_m = stlab::async(
+        stlab::default_executor, [worker, body, position, sentry_position, sentry_set_path] {
+            return worker->analyze_body(*body, position, sentry_position, sentry_set_path);
+        });
+
+    element.deferred_m = true;
+
+    input_m.seek(sentry_position);
+}
+
+/****************************************************************************************************/
+
+bool binspector_analyzer_t::analyze_body(const compiled_structure_t& structure,
+                                         inspection_position_t       position,
+                                         inspection_position_t       sentry_position,
+                                         const std::string&          sentry_set_path) {
+    try {
+        inspection_branch_t element(adobe::child_begin(forest_m->begin()).base());
+
+        input_m.seek(position);
+
+        current_leaf_m            = element;
+        current_sentry_m          = sentry_position;
+        current_sentry_set_path_m = sentry_set_path;
+
+        // The sentry's own check, but a body that falls short is analyzed again rather than warned
+        // about here.
+        return analyze_with_structure(structure, element) && input_m.pos() == sentry_position;
+    } catch (const std::runtime_error&) {
+        // e.g., EOF, or a field that needs more than the element; see signal_end_of_file.
+        return false;
+    } catch (const std::out_of_range&) {
+        return false;
+    }
+}
+
+/****************************************************************************************************/
+
+bool binspector_analyzer_t::commit_body(speculated_element_t& element) {
+    if (!element.deferred_m || !stlab::blocking_get(element.body_m) || element.messages_m->tellp() > 0) {
+        element.failed_m = true;
+
+        return false;
+    }
+
+    inspection_forest_t& forest(*element.worker_m->forest_m);
+    inspection_branch_t  copy(adobe::child_begin(forest.begin()).base());
+    inspection_branch_t  branch(element.element_m);
+
+    if (copy->start_offset_m != element.start_offset_m ||
+        copy->end_offset_m != element.end_offset_m) {
+        element.failed_m = true;
+
+        return false;
+    }
+
+    inspection_forest_t::child_iterator body(adobe::child_begin(copy));
+    inspection_forest_t::child_iterator trailer(adobe::child_begin(branch));
+
+    // What the body did to the header: e.g., enumerated over one of its atoms.
+    for (std::size_t i(0); i != element.header_count_m; ++i, ++body, ++trailer) {
+        trailer->use_count_m += body->use_count_m;
+
+        if (!body->option_set_m.empty())
+            trailer->option_set_m = body->option_set_m;
+    }
+
+    std::vector<inspection_branch_t> moved;
+
+    for (inspection_forest_t::child_iterator iter(body), last(adobe::child_end(copy));
+         iter != last;
+         ++iter)
+        moved.push_back(iter.base());
+
+    if (!moved.empty()) {
+        inspection_branch_t position(trailer == adobe::child_end(branch) ?
+                                         adobe::trailing_of(branch) :
+                                         trailer.base());
+
+        forest_m->splice(position, forest, body, adobe::child_end(copy));
+    }
+
+    for (inspection_branch_t child : moved) {
+        link_child(branch, child);
+
+        // implicit arrays materialize their elements into the forest they are in now.
+        inspection_branch_t first(adobe::leading_of(child));
+        inspection_branch_t last(adobe::trailing_of(child));
+
+        for (++last; first != last; ++first)
+            if (first.edge() == adobe::forest_leading_edge && first->forest_m)
+                first->forest_m = forest_m.get();
+    }
+
+    // The body's names rank between the header's and the trailer's, as if analyzed in order.
+    reindex_children(branch);
+
+    // unless the trailer had a summary of its own
+    if (branch->summary_expression_m == element.summary_expression_m &&
+        copy->summary_expression_m != element.summary_expression_m) {
+        branch->summary_m            = copy->summary_m;
+        branch->summary_expression_m = copy->summary_expression_m;
+        branch->set_flag(is_summary_rendered_k, copy->get_flag(is_summary_rendered_k));
+    }
+
+    element.worker_m.reset();
+
+    return true;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::roll_back(inspection_branch_t         root,
+                                      const speculated_element_t& element) {
+    while (root->cardinal_m != element.index_m) {
+        --root->cardinal_m;
+
+        inspection_branch_t last(find_element(root, root->cardinal_m));
+
+        root->element_table_m->erase(root->element_table_m->find(root->cardinal_m));
+
+        forest_m->erase(last);
+    }
+
+    root->end_offset_m = element.root_end_offset_m;
+
+    input_m.seek(element.position_m);
+}
+
+/****************************************************************************************************/
+
+/*
+    With set_streaming, a node no expression names (see mark_referenced_fields) is erased once it is
+    done: a field is only ever found by name from at or below its parent, so nothing could look it,
+    or anything in it, up again. Of a struct that is kept, the children go, too, but those named by
+    late_names_m: a bare name is only found at or above where it is used, so one only the struct's
+    own expressions use does not outlive it. What is kept is the chain of nodes still being analyzed
+    and the fields something could still look up. (Checkpoints hold on to nodes, so set_incremental
+    keeps them all, and so does set_lazy, as a body left for later looks up whatever is above it.)
+*/
+void binspector_analyzer_t::finish_node(frame_t& frame) {
+    pending_t&          pending(frame.pending_m);
+    inspection_branch_t done(pending.sub_branch_m);
+    bool                discard(streaming_m && !incremental_m && !pending.field_m->referenced_m);
+
+    if (pending.remote_position_m) {
+        // restore the position marker if it was tweaked to read this field
+        input_m.seek(pending.position_save_m);
+    } else {
+        // If it's not a remote position we want to cache the end
+        // offset for this node in its parent. Because the nodes
+        // are in increasing order in the file we overwrite the
+        // end offset with whatever the most current value is.
+        frame.parent_m->end_offset_m = input_m.pos() - inspection_byte_k;
+    }
+
+    restore_pending(frame);
+
+    if (done == inspection_branch_t())
+        return;
+
+    if (discard) {
+        unindex_child(frame.parent_m, done);
+        forest_m->erase(done);
+    } else if (streaming_m && !incremental_m && !lazy_m && !done->get_flag(is_array_root_k)) {
+        drop_local_children(done);
+    }
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::drop_local_children(inspection_branch_t branch) {
+    std::vector<inspection_branch_t> dropped;
+
+    for (inspection_forest_t::child_iterator iter(adobe::child_begin(branch)),
+         last(adobe::child_end(branch));
+         iter != last;
+         ++iter)
+        if (late_names_m.count(iter->name_m) == 0)
+            dropped.push_back(iter.base());
+
+    for (inspection_branch_t child : dropped) {
+        unindex_child(branch, child);
+        forest_m->erase(child);
+    }
+}
+
+/****************************************************************************************************/
+
+const std::shared_ptr<const binspector_analyzer_t::typedef_scope_t>&
+binspector_analyzer_t::typedef_snapshot() {
+    if (!typedef_snapshot_m || typedef_snapshot_m->generation() != typedef_scope_m.generation())
+        typedef_snapshot_m = std::make_shared<const typedef_scope_t>(typedef_scope_m);
+
+    return typedef_snapshot_m;
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::checkpoint() {
+    const frame_t& frame(frames_m.back());
+
+    // One that had been no further into the file is good for no more edits than this one.
+    if (checkpoints_m.empty() || checkpoints_m.back().reach_m != input_m.reach())
+        checkpoints_m.push_back(checkpoint_t());
+
+    checkpoint_t& checkpoint(checkpoints_m.back());
+
+    checkpoint.frame_m                         = frame;
+    checkpoint.typedef_scope_m                 = typedef_snapshot();
+    checkpoint.current_leaf_m                  = current_leaf_m;
+    checkpoint.current_enumerated_value_m      = current_enumerated_value_m;
+    checkpoint.current_enumerated_option_set_m = current_enumerated_option_set_m;
+    checkpoint.current_enumerated_found_m      = current_enumerated_found_m;
+    checkpoint.current_sentry_m                = current_sentry_m;
+    checkpoint.current_sentry_set_path_m       = current_sentry_set_path_m;
+    checkpoint.eof_signalled_m                 = eof_signalled_m;
+    checkpoint.position_m                      = input_m.pos();
+    checkpoint.reach_m                         = input_m.reach();
+    checkpoint.signal_count_m                  = signal_log_m.size();
+    checkpoint.output_mark_m                   = output_m.tellp();
+    checkpoint.error_mark_m                    = error_m.tellp();
+
+    // main, and the node of the field it is part way through, if any
+    inspection_branch_t open[] = {frame.parent_m, frame.pending_m.sub_branch_m};
+
+    checkpoint.open_nodes_m.clear();
+
+    for (inspection_branch_t branch : open) {
+        if (branch == inspection_branch_t())
+            continue;
+
+        checkpoint.open_nodes_m.push_back(open_node_t{branch,
+                                                      last_child_of(branch),
+                                                      branch->start_offset_m,
+                                                      branch->end_offset_m,
+                                                      branch->cardinal_m,
+                                                      branch->summary_m,
+                                                      branch->summary_expression_m,
+                                                      branch->get_flag(is_summary_rendered_k)});
+    }
+}
+
+/****************************************************************************************************/
+
+void binspector_analyzer_t::restore(const checkpoint_t& checkpoint) {
+    for (const open_node_t& node : checkpoint.open_nodes_m) {
+        inspection_branch_t branch(node.branch_m);
+
+        erase_children_after(*forest_m, branch, node.last_child_m);
+
+        branch->start_offset_m       = node.start_offset_m;
+        branch->end_offset_m         = node.end_offset_m;
+        branch->cardinal_m           = node.cardinal_m;
+        branch->summary_m            = node.summary_m;
+        branch->summary_expression_m = node.summary_expression_m;
+        branch->set_flag(is_summary_rendered_k, node.summary_rendered_m);
+    }
+
+    // What is left was all there at the checkpoint. Whatever was evaluated since is forgotten.
+    std::set<const forest_node_t*>         slots;
+    inspection_forest_t::preorder_iterator iter(forest_m->begin());
+    inspection_forest_t::preorder_iterator last(forest_m->end());
+
+    for (; iter != last; ++iter) {
+        forest_node_t& node(*iter);
+
+        if (node.get_flag(type_const_k) || node.get_flag(type_slot_k))
+            node.evaluated_m = false;
+
+        if (node.get_flag(type_slot_k))
+            slots.insert(&node);
+    }
+
+    // The signals since are taken back, last first, from the slots that are still there.
+    while (signal_log_m.size() != checkpoint.signal_count_m) {
+        signal_record_t& record(signal_log_m.back());
+
+        if (slots.count(record.slot_m)) {
+            record.slot_m->expression_m          = std::move(record.expression_m);
+            record.slot_m->compiled_expression_m = record.compiled_expression_m;
+        }
+
+        signal_log_m.pop_back();
+    }
+
+    frames_m.assign(1, checkpoint.frame_m);
+
+    typedef_scope_m                 = *checkpoint.typedef_scope_m;
+    typedef_snapshot_m              = checkpoint.typedef_scope_m; // generations since are stale
+    current_leaf_m                  = checkpoint.current_leaf_m;
+    current_enumerated_value_m      = checkpoint.current_enumerated_value_m;
+    current_enumerated_option_set_m = checkpoint.current_enumerated_option_set_m;
+    current_enumerated_found_m      = checkpoint.current_enumerated_found_m;
+    current_sentry_m                = checkpoint.current_sentry_m;
+    current_sentry_set_path_m       = checkpoint.current_sentry_set_path_m;
+    eof_signalled_m                 = checkpoint.eof_signalled_m;
+
+    input_m.seek(checkpoint.position_m);
+    input_m.set_reach(checkpoint.reach_m);
+
+    // the messages since are written again, or not, as the edited file has it
+    output_m.seekp(checkpoint.output_mark_m);
+    error_m.seekp(checkpoint.error_mark_m);
 }
 
 /****************************************************************************************************/
 
-const binspector_analyzer_t::structure_type& binspector_analyzer_t::structure_for(
+const binspector_analyzer_t::compiled_structure_t& binspector_analyzer_t::structure_for(
     adobe::name_t structure_name) {
-    structure_map_t::const_iterator structure(structure_map_m.find(structure_name));
+    compiled_structure_map_t::const_iterator structure(
+        compiled_structure_map_m.find(structure_name));
 
-    if (structure == structure_map_m.end())
+    if (structure == compiled_structure_map_m.end())
         throw std::runtime_error(
             adobe::make_string("Could not find structure '", structure_name.c_str(), "'"));
 
@@ -8,12 +8,37 @@
 // identity
 #include <binspector/bitreader.hpp>
 
+// stdc
+#if !BOOST_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BINSPECTOR_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define BINSPECTOR_SSE2 0
+#endif
+
 // stc++
 #include <cassert>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <stdexcept>
 
+// boost
+#include <boost/filesystem/fstream.hpp>
+
+// application
+#include <binspector/endian.hpp>
+
 /****************************************************************************************************/
 
 namespace {
@@ -29,50 +54,187 @@ inline boost::uint8_t mask_for_low_bits(boost::uint8_t numbits) {
 }
 
 /****************************************************************************************************/
-// returns a mask for the N highest bits of the byte.
-inline boost::uint8_t mask_for_high_bits(boost::uint8_t numbits) {
-    assert(numbits <= 8);
+/*
+    Copies the bit_count bits that start bit_offset (< 8) bits into src, most significant bit
+    first, into the bytesize(bit_count + 7) bytes at dst such that they are right-justified. src
+    must cover every byte the span touches.
+
+    The first destination byte takes the leading bit_count % 8 bits (or 8 of them) through a 16 bit
+    window over the first two source bytes. Every byte after that straddles a pair of source bytes
+    at the same shift, so they are produced eight at a time: a 64 bit big-endian load is shifted
+    up and the vacated low bits are filled from the byte following the window.
+*/
+void extract_bits(const boost::uint8_t* src,
+                  boost::uint8_t         bit_offset,
+                  boost::uint64_t        bit_count,
+                  boost::uint8_t*        dst) {
+    assert(bit_offset < 8 && bit_count != 0);
+
+    boost::uint64_t rest(bytesize(bit_count - 1));
+    boost::uint8_t  lead(static_cast<boost::uint8_t>(bit_count - (rest << 3))); // 1..8
+    boost::uint8_t  end(bit_offset + lead);                                       // 1..15
+    boost::uint16_t window(src[0] << 8);
+
+    if (end > 8)
+        window |= src[1];
+
+    *dst++ = static_cast<boost::uint8_t>(window >> (16 - end)) & mask_for_low_bits(lead);
+
+    src += bytesize(end);
+
+    boost::uint8_t shift(bitsize(end));
+
+    if (shift == 0) {
+        std::copy(src, src + rest, dst);
+
+        return;
+    }
+
+    // The byte following each window is always part of the span when shift != 0.
+    for (; rest >= 8; rest -= 8, src += 8, dst += 8) {
+        boost::uint64_t word(load_endian<boost::uint64_t>(src, true));
+
+        store_endian<boost::uint64_t>(word << shift | src[8] >> (8 - shift), dst, true);
+    }
 
-    return ~mask_for_low_bits(8 - numbits);
+    for (; rest != 0; --rest, ++src)
+        *dst++ = static_cast<boost::uint8_t>(src[0] << shift | src[1] >> (8 - shift));
 }
 
 /****************************************************************************************************/
+#if BINSPECTOR_SSE2
+inline int lowest_set_bit(unsigned int x) {
+#if defined(_MSC_VER)
+    unsigned long result;
 
-inline boost::uint8_t mask_for_bits(boost::uint8_t start_bit, boost::uint8_t num_bits) {
-    return mask_for_high_bits(num_bits) >> start_bit;
-}
+    _BitScanForward(&result, x);
 
+    return static_cast<int>(result);
+#else
+    return __builtin_ctz(x);
+#endif
+}
+#endif
 /****************************************************************************************************/
+/*
+    Returns the first match for the size byte pattern in [first, last) whose distance from first is
+    a multiple of stride, or last if there is none.
+
+    With SSE2 sixteen candidates are tested at once by comparing both the first and the last byte
+    of the pattern against a broadcast of each, so only positions matching at both ends are handed
+    to memcmp. Strides that divide sixteen fall in the same lanes of every block and are masked in;
+    other strides are compared one candidate at a time.
+*/
+const boost::uint8_t* find_pattern(const boost::uint8_t* first,
+                                   const boost::uint8_t* last,
+                                   const boost::uint8_t* pattern,
+                                   std::size_t           size,
+                                   std::size_t           stride) {
+    assert(size != 0 && stride != 0);
+
+    if (static_cast<std::size_t>(last - first) < size)
+        return last;
+
+    // candidates are [0, count) from first
+    std::size_t count(static_cast<std::size_t>(last - first) - size + 1);
+    std::size_t i(0);
+
+#if BINSPECTOR_SSE2
+    if (16 % stride == 0) {
+        static const int stride_mask_k[] = {0xffff, 0x5555, 0, 0x1111, 0, 0, 0, 0x0101};
+        const int        stride_mask(stride == 16 ? 0x0001 : stride_mask_k[stride - 1]);
+        const __m128i    head(_mm_set1_epi8(static_cast<char>(pattern[0])));
+        const __m128i    tail(_mm_set1_epi8(static_cast<char>(pattern[size - 1])));
+
+        // The tail load of a block ends at candidate i + 15 plus size - 1: still inside the range.
+        for (; count - i >= 16; i += 16) {
+            const boost::uint8_t* p(first + i);
+            __m128i at_head(_mm_cmpeq_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), head));
+            __m128i at_tail(_mm_cmpeq_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + size - 1)), tail));
+            unsigned int hits(_mm_movemask_epi8(_mm_and_si128(at_head, at_tail)) & stride_mask);
+
+            for (; hits != 0; hits &= hits - 1) {
+                const boost::uint8_t* candidate(p + lowest_set_bit(hits));
+
+                if (std::memcmp(candidate, pattern, size) == 0)
+                    return candidate;
+            }
+        }
+    }
+#endif
+
+    if (stride == 1) {
+        // memchr is vectorized by the C library where SSE2 is not available to us.
+        while (i < count) {
+            const void* hit(std::memchr(first + i, pattern[0], count - i));
 
-inline boost::uint8_t split_byte(boost::uint8_t& src,
-                                 boost::uint8_t& dst,
-                                 boost::uint8_t  start_bit,
-                                 boost::uint8_t  num_bits) {
-    boost::uint8_t byte_mask(mask_for_bits(start_bit, num_bits));
-    boost::uint8_t dst_size(8 - (start_bit + num_bits));
+            if (!hit)
+                return last;
 
-    dst = src & ~byte_mask;
-    src &= byte_mask;
-    src >>= dst_size;
+            const boost::uint8_t* candidate(static_cast<const boost::uint8_t*>(hit));
 
-    return dst_size;
+            if (std::memcmp(candidate, pattern, size) == 0)
+                return candidate;
+
+            i = static_cast<std::size_t>(candidate - first) + 1;
+        }
+
+        return last;
+    }
+
+    for (; i < count; i += stride)
+        if (first[i] == pattern[0] && std::memcmp(first + i, pattern, size) == 0)
+            return first + i;
+
+    return last;
 }
 
+/****************************************************************************************************/
+
+} // namespace
+
 /****************************************************************************************************/
 #if 0
-void merge_byte(boost::uint8_t  src,
-                boost::uint8_t  src_start_bit,
-                boost::uint8_t& dst,
-                boost::uint8_t  dst_start_bit,
-                boost::uint8_t  num_bits)
-{
-    // Copies num_bits of src starting at src_start_bit into dst starting at dst_start_bit.
-    // Note: If src_start_bit == dst_start_bit then it's a straight-up mask and merge.
-}
+#pragma mark -
 #endif
 /****************************************************************************************************/
 
-} // namespace
+mapped_file_t::mapped_file_t(const boost::filesystem::path& path) : data_m(nullptr), size_m(0) {
+#if !BOOST_WINDOWS
+    int fd(::open(path.c_str(), O_RDONLY));
+
+    if (fd == -1)
+        return;
+
+    struct stat info;
+
+    // mmap refuses zero-length mappings; empty files go through the stream fallback.
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 &&
+        static_cast<boost::uint64_t>(info.st_size) <= std::numeric_limits<std::size_t>::max()) {
+        std::size_t size(static_cast<std::size_t>(info.st_size));
+        void*       data(::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+
+        if (data != MAP_FAILED) {
+            data_m = static_cast<const boost::uint8_t*>(data);
+            size_m = size;
+        }
+    }
+
+    // The mapping holds its own reference to the file.
+    ::close(fd);
+#endif
+}
+
+/****************************************************************************************************/
+
+mapped_file_t::~mapped_file_t() {
+#if !BOOST_WINDOWS
+    if (data_m)
+        ::munmap(const_cast<boost::uint8_t*>(data_m), static_cast<std::size_t>(size_m));
+#endif
+}
 
 /****************************************************************************************************/
 #if 0
@@ -81,14 +243,47 @@ void merge_byte(boost::uint8_t  src,
 /****************************************************************************************************/
 
 bitreader_t::bitreader_t(std::istream& input)
-    : input_m(input), saught_m(false), remainder_bits_m(0), remainder_size_m(0) {
-    input_m.clear();
+    : input_m(&input), mapped_m(nullptr), stream_head_m(0),
+      cache_block_size_m(default_cache_block_size_k),
+      cache_block_count_m(default_cache_block_count_k), cache_tick_m(0), cache_hits_m(0),
+      cache_misses_m(0) {
+    init_stream();
+}
+
+/****************************************************************************************************/
 
-    input.seekg(0, std::ios::end);
+bitreader_t::bitreader_t(const boost::filesystem::path& path)
+    : input_m(nullptr), mapping_m(std::make_shared<mapped_file_t>(path)), mapped_m(nullptr),
+      stream_head_m(0), cache_block_size_m(default_cache_block_size_k),
+      cache_block_count_m(default_cache_block_count_k), cache_tick_m(0), cache_hits_m(0),
+      cache_misses_m(0) {
+    if (mapping_m->is_open()) {
+        mapped_m = mapping_m->data();
+        size_m   = bytepos(mapping_m->size());
 
-    size_m = bytepos(input.tellg());
+        return;
+    }
 
-    input.seekg(0);
+    mapping_m.reset();
+
+    owned_input_m = std::make_shared<boost::filesystem::ifstream>(path, std::ios_base::binary);
+    input_m       = owned_input_m.get();
+
+    init_stream();
+}
+
+/****************************************************************************************************/
+
+void bitreader_t::init_stream() {
+    input_m->clear();
+
+    input_m->seekg(0, std::ios::end);
+
+    size_m = bytepos(input_m->tellg());
+
+    input_m->seekg(0);
+
+    stream_head_m = 0;
 
     //if (size_m == invalid_position_k)
     //    throw std::runtime_error("bitreader_t: failed to get input file size");
@@ -96,13 +291,28 @@ bitreader_t::bitreader_t(std::istream& input)
 
 /****************************************************************************************************/
 
+void bitreader_t::set_cache(std::size_t block_size, std::size_t block_count) {
+    if (block_size == 0)
+        throw std::runtime_error("bitreader_t::set_cache: block size must be nonzero");
+
+    cache_m.clear();
+
+    // cached_block hands out references into the cache; it must never reallocate.
+    cache_m.reserve(block_count);
+
+    cache_block_size_m  = block_size;
+    cache_block_count_m = block_count;
+}
+
+/****************************************************************************************************/
+
 void bitreader_t::seek(const pos_t& position) {
     if (position_m == position)
         return;
 
-    position_m = position;
+    extend_reach(position_m);
 
-    saught_m = true;
+    position_m = position;
 }
 
 /****************************************************************************************************/
@@ -119,8 +329,6 @@ bitreader_t::pos_t bitreader_t::advance(const pos_t& position) {
 
     position_m += position;
 
-    saught_m = true;
-
     return result;
 }
 
@@ -133,180 +341,293 @@ bool bitreader_t::eof() const {
 /****************************************************************************************************/
 
 bool bitreader_t::fail() const {
-    return input_m.fail();
+    // reads from a mapping throw before they can fail.
+    return input_m && input_m->fail();
 }
 
 /****************************************************************************************************/
 
 void bitreader_t::clear() {
-    return input_m.clear();
+    if (input_m)
+        input_m->clear();
 }
 
 /****************************************************************************************************/
 
 boost::uint8_t bitreader_t::peek() {
-    lazy_seek();
-
     // If we're at or past the end of the file and try to advance again, we're done.
     if (eof())
         throw std::out_of_range("bitreader_t::peek: end of file");
 
-    return input_m.peek();
+    // the one read that leaves the position where it was
+    extend_reach(bytepos(position_m.bytes() + 1));
+
+    return *fetch(position_m.bytes(), 1, scratch_m);
 }
 
 /****************************************************************************************************/
 
-rawbytes_t bitreader_t::read_bits(boost::uint64_t inbits) {
-    lazy_seek();
+rawbytes_t bitreader_t::read_bits(boost::uint64_t bits) {
+    rawbytes_t result;
 
-    boost::uint64_t read_bytes(bytesize(inbits));
-    boost::uint8_t  read_bits(bitsize(inbits));
-    bool            byte_aligned_read(read_bits == 0);
+    read_bits_into(bits, result);
 
-    if (read_bytes == 0 && read_bits == 0)
-        return rawbytes_t();
+    return result;
+}
 
-    /*
-        A viable case is where we want to read bits completely present in the
-        remainder_bits_m. Handle that here.
-    */
-    if (read_bytes == 0) {
-        if (read_bits == remainder_size_m) {
-            // A common case where the remainder bits make up a field.
+/****************************************************************************************************/
 
-            rawbytes_t result(1, remainder_bits_m & mask_for_low_bits(read_bits));
+void bitreader_t::read_bits_into(boost::uint64_t bits, rawbytes_t& result) {
+    if (bits == 0) {
+        result.clear();
 
-            remainder_size_m = 0;
+        return;
+    }
 
-            position_m += bitpos(inbits);
+    boost::uint8_t  offset(position_m.bits());
+    boost::uint64_t span(bytesize(offset + bits + 7));
 
-            return result;
-        } else if (read_bits < remainder_size_m) {
-            // still some bits left over.
-            boost::uint8_t diff_size = remainder_size_m - read_bits;
+    // reuses the capacity of the caller's buffer; no allocation once it is warm.
+    if (offset == 0 && bitsize(bits) == 0) {
+        // byte aligned: the stream can read straight into the result.
+        const boost::uint8_t* src(fetch(position_m.bytes(), span, result));
 
-            rawbytes_t result(1, remainder_bits_m >> diff_size);
+        if (src != result.data())
+            result.assign(src, src + span);
+    } else {
+        const boost::uint8_t* src(fetch(position_m.bytes(), span, scratch_m));
 
-            remainder_bits_m &= mask_for_low_bits(diff_size);
-            remainder_size_m = diff_size;
+        result.resize(static_cast<std::size_t>(bytesize(bits + 7)));
 
-            position_m += bitpos(inbits);
+        extract_bits(src, offset, bits, result.data());
+    }
 
-            return result;
-        }
+    position_m += bitpos(bits);
+}
+
+/****************************************************************************************************/
+
+rawview_t bitreader_t::read_bits_view(boost::uint64_t bits) {
+    if (!mapped_m || bitsize(bits) != 0 || !position_m.byte_aligned()) {
+        read_bits_into(bits, buffer_m);
+
+        return rawview_t(buffer_m.data(), buffer_m.data() + buffer_m.size());
     }
 
-    // Here we are reading X bytes and Y bits, where X*8+Y bits > remainder_bits_m
+    boost::uint64_t       size(bytesize(bits));
+    const boost::uint8_t* first(fetch(position_m.bytes(), size, buffer_m));
 
-    std::size_t result_size(
-        static_cast<std::size_t>(byte_aligned_read ? read_bytes : read_bytes + 1));
-    rawbytes_t result(result_size, 0);
+    position_m += bytepos(size);
 
-#if 0
-    if (result_size == 0)
-        return result; // ask for no bits - you got 'em!
-#endif
+    return rawview_t(first, first + size);
+}
 
-    if (remainder_size_m == 0) {
-        input_m.read(reinterpret_cast<char*>(&result[0]), result_size);
-
-        /*
-            Given there is no remainder, if the read is to be byte-aligned
-            then we're done here. If the read is non-byte-aligned then we
-            split the last byte's bits between the remainder and the output.
-        */
-        if (!byte_aligned_read) {
-            // mask off last byte and set remainder
-            remainder_size_m =
-                split_byte(result.back(), remainder_bits_m, position_m.bits(), read_bits);
-        }
-    } else {
-        /*
-        Here we are reading X.Y bytes with Z bits of remainder.
+/****************************************************************************************************/
 
-        Preconditions to get here:
-            - X is usually nonzero, but can be zero if Y > Z.
-            - Y can be zero or nonzero.
-            - Z must be nonzero. (Otherwise handled by the above if clause)
+boost::uint64_t bitreader_t::read_uint(boost::uint64_t bits, bool is_big_endian) {
+    if (bits > 64)
+        throw std::runtime_error("bitreader_t::read_uint: more than 64 bits requested");
 
-        As such we cannot copy the file data as-is, but have to shift everything from the raw read
-        down by Z bits and slap the initial remainder in the front of the result.
+    boost::uint64_t first(position_m.bytes());
+    boost::uint8_t  offset(position_m.bits());
 
-        Pseudocode:
+    // A mapped field that fits in one 64 bit window is shifted straight out of it, aligned or not.
+    // Wider little-endian fields take the general path below.
+    if (mapped_m && bits != 0 && offset + bits <= 64 && size_m.bytes() >= 8 &&
+        first <= size_m.bytes() - 8 && (is_big_endian || bits <= 8)) {
+        boost::uint64_t word(load_endian<boost::uint64_t>(mapped_m + first, true));
 
-        for (int N = 0 to result_size)
-        {
-            // Copy current remainder into high bits of current result byte:
-            //     result[N.7..8-Z] = remainder[Z-1..0];
-            copy_bits(remainder, Z-1, result[N], 7, Z);
+        position_m += bitpos(bits);
 
-            // Copy 8-Z raw bits into current location in result byte:
-            //     result[N.7-Z..0] = raw[N.7..Z];
-            copy_bits(raw[N], 7, result[N], 7-Z, 8-Z);
+        return word << offset >> (64 - bits);
+    }
 
-            // Copy remainder of current raw byte into remainder for next iteration:
-            //     remainder[Z-1..0] = raw[Z-1..0];
-            copy_bits(raw[N], Z-1, remainder[N], Z-1, Z);
-        }
+    // Mapped, byte-aligned reads come straight out of the mapping; everything else goes through
+    // the reused internal buffer. Neither allocates.
+    rawview_t raw(read_bits_view(bits));
 
-        ... and something at the end will get tacked on when Y != Z.
+    return uint_from_bytes(raw.begin(), raw.size(), is_big_endian);
+}
 
-        If I treated the result with a 16-bit window, then the code would look like:
-        
-        result[0.15..16-Z] = remainder[Z-1..0];
+/****************************************************************************************************/
 
-        for (int N = 0 to X) // note: not result_size!
-        {
-            result[N.15-Z..15-Z-8] = raw[N];
-            // note that though we have a 16 bit window we're iterating 8 bits at a time...
-            // This allows the whole-hog copy of raw[N] to span over two bytes in a single
-            // operation.
-            // (Would there be an endianness issue with this method?)
-        }
+boost::uint64_t bitreader_t::find(const boost::uint8_t* pattern,
+                                  std::size_t           size,
+                                  std::size_t           stride) {
+    if (size == 0 || stride == 0)
+        throw std::runtime_error("bitreader_t::find: empty pattern or stride");
 
-        ... and something at the end will get tacked on when Y != Z.
+    restore_point_t restore_point(*this);
+    pos_t           start(position_m);
 
-        // tack on the difference from Y to Z here:
-        */
+    if (start >= size_m)
+        return not_found_k;
 
-        throw std::logic_error(
-            "Asking for more than the remainder present; tell fbrereto to implement this!");
-#if 0
-        // here we have a remainder that will require all our bits get shifted accordingly.
-        rawbytes_t raw(result_size, 0);
+    // whole bytes from here to the end of the input; a partial last byte does not count.
+    boost::uint64_t available((size_m - start).bytes());
 
-        input_m.read(reinterpret_cast<char*>(&result[0]), result_size);
-#endif
+    // A mapped, byte-aligned search is made over the rest of the input at once. Otherwise the
+    // input is searched a block at a time, with consecutive blocks overlapping by enough that a
+    // pattern cannot straddle them unseen.
+    boost::uint64_t block(mapped_m && start.byte_aligned() ?
+                              available :
+                              std::max<boost::uint64_t>(cache_block_size_m, size + stride));
+    boost::uint64_t offset(0); // always a multiple of stride
+
+    while (available - offset >= size) {
+        boost::uint64_t       length(std::min(block, available - offset));
+        rawview_t             bytes(read_bits_view(start + bytepos(offset), length << 3));
+        const boost::uint8_t* found(find_pattern(bytes.begin(), bytes.end(), pattern, size, stride));
+
+        if (found != bytes.end())
+            return offset + static_cast<boost::uint64_t>(found - bytes.begin());
+
+        if (offset + length == available)
+            break;
+
+        // resume at the first candidate that could not be tested in full.
+        offset += (length - size + 1) / stride * stride;
     }
 
-    position_m += bitpos(inbits);
+    return not_found_k;
+}
 
-    // a failure here can be EOF or something else; test for both cases and respond accordingly.
-    if (input_m.fail()) {
-        if (input_m.eof()) {
+/****************************************************************************************************/
+
+const boost::uint8_t* bitreader_t::fetch(boost::uint64_t first,
+                                         boost::uint64_t size,
+                                         rawbytes_t&     scratch) {
+    if (mapped_m) {
+        if (first > size_m.bytes() || size > size_m.bytes() - first)
             throw std::out_of_range("bitreader_t: end of file");
-        } else {
-            std::stringstream error;
-            std::streamoff    offset(input_m.tellg());
-            error << "Input stream fail; offset: " << offset << ", size: " << bitpos(inbits);
-            throw std::runtime_error(error.str());
+
+        return mapped_m + first;
+    }
+
+    // Reads larger than a block would only churn the cache.
+    if (cache_block_count_m == 0 || size > cache_block_size_m) {
+        scratch.resize(static_cast<std::size_t>(size));
+
+        read_stream(first, scratch.data(), scratch.size(), false);
+
+        return scratch.data();
+    }
+
+    boost::uint64_t index(first / cache_block_size_m);
+    std::size_t     offset(static_cast<std::size_t>(first % cache_block_size_m));
+    const block_t&  block(cached_block(index));
+
+    // Most reads fall within a single block and are served from it in place.
+    if (offset + size <= block.bytes_m.size())
+        return &block.bytes_m[offset];
+
+    // Otherwise the read straddles two blocks, unless this was the last one.
+    if (block.bytes_m.size() != cache_block_size_m)
+        throw std::out_of_range("bitreader_t: end of file");
+
+    std::size_t head(cache_block_size_m - offset);
+    std::size_t tail(static_cast<std::size_t>(size) - head);
+
+    scratch.resize(static_cast<std::size_t>(size));
+
+    std::copy(&block.bytes_m[offset], &block.bytes_m[0] + cache_block_size_m, &scratch[0]);
+
+    const block_t& next(cached_block(index + 1));
+
+    if (tail > next.bytes_m.size())
+        throw std::out_of_range("bitreader_t: end of file");
+
+    std::copy(&next.bytes_m[0], &next.bytes_m[0] + tail, &scratch[head]);
+
+    return scratch.data();
+}
+
+/****************************************************************************************************/
+
+const bitreader_t::block_t& bitreader_t::cached_block(boost::uint64_t index) {
+    block_t* victim(nullptr);
+
+    ++cache_tick_m;
+
+    // The cache is small enough that a linear search beats maintaining an index into it.
+    for (auto& block : cache_m) {
+        if (block.index_m == index) {
+            block.last_use_m = cache_tick_m;
+
+            ++cache_hits_m;
+
+            return block;
         }
+
+        if (!victim || block.last_use_m < victim->last_use_m)
+            victim = &block;
     }
 
-    return result;
+    ++cache_misses_m;
+
+    if (cache_m.size() < cache_block_count_m) {
+        cache_m.push_back(block_t());
+
+        victim = &cache_m.back();
+    }
+
+    // in case the read throws, leave the block matching nothing.
+    victim->index_m = invalid_position_k.bytes();
+
+    victim->bytes_m.resize(cache_block_size_m);
+
+    victim->bytes_m.resize(read_stream(index * cache_block_size_m,
+                                       victim->bytes_m.data(),
+                                       victim->bytes_m.size(),
+                                       true));
+
+    victim->index_m    = index;
+    victim->last_use_m = cache_tick_m;
+
+    return *victim;
 }
 
 /****************************************************************************************************/
 
-void bitreader_t::lazy_seek() {
-    if (!saught_m)
-        return;
+std::size_t bitreader_t::read_stream(boost::uint64_t first,
+                                     boost::uint8_t* dst,
+                                     std::size_t     size,
+                                     bool            short_ok) {
+    // Sequential reads leave the stream where the next one starts; only move it when they don't.
+    if (stream_head_m != first)
+        input_m->seekg(static_cast<std::streamoff>(first));
+
+    input_m->read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(size));
+
+    std::size_t count(static_cast<std::size_t>(input_m->gcount()));
+
+    // a failure here can be EOF or something else; test for both cases and respond accordingly.
+    if (input_m->fail()) {
+        // The last block of the input is expected to come up short. It's not an error (yet).
+        if (short_ok && input_m->eof() && !input_m->bad()) {
+            input_m->clear();
 
-    input_m.seekg(static_cast<std::streamoff>(position_m.bytes()));
+            stream_head_m = first + count;
+
+            return count;
+        }
+
+        // the read head is anyone's guess now; make the next read seek.
+        stream_head_m = invalid_position_k.bytes();
+
+        if (input_m->eof()) {
+            throw std::out_of_range("bitreader_t: end of file");
+        } else {
+            std::stringstream error;
+            std::streamoff    offset(input_m->tellg());
+            error << "Input stream fail; offset: " << offset << ", size: " << bytepos(size);
+            throw std::runtime_error(error.str());
+        }
+    }
 
-    remainder_size_m = 0;
+    stream_head_m = first + size;
 
-    saught_m = false;
+    return size;
 }
 
 /****************************************************************************************************/
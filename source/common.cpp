@@ -10,6 +10,9 @@
 
 // stdc++
 #include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
 
 // boost
 #include <boost/lexical_cast.hpp>
@@ -22,6 +25,7 @@
 
 // application
 #include <binspector/endian.hpp>
+#include <binspector/expression.hpp>
 
 /****************************************************************************************************/
 
@@ -29,16 +33,61 @@ namespace {
 
 /****************************************************************************************************/
 
+bool interpret_expressions_s(false); // see set_interpret_expressions
+
+// Set while an evaluation that reports the end of the file rather than throwing is under way on
+// this thread; see evaluate_reporting.
+thread_local bool* end_of_file_s(nullptr);
+
+/****************************************************************************************************/
+
+// Whether the bits at position run past the end of the input. Unless the end of the file is being
+// reported (see end_of_file_s), running past it throws, as the read itself would have.
+bool past_end(const bitreader_t&            input,
+              const inspection_position_t& position,
+              boost::uint64_t              bits) {
+    if (!(input.size() < position + bitpos(bits)))
+        return false;
+
+    if (!end_of_file_s)
+        throw std::out_of_range("bitreader_t: end of file");
+
+    *end_of_file_s = true;
+
+    return true;
+}
+
+/****************************************************************************************************/
+
+// raw holds the value's bytes in host order, zero-extended; T truncates (and for the signed types
+// sign-extends) it to the width of the atom.
 template <typename T>
-inline adobe::any_regular_t convert_raw(const rawbytes_t& raw) {
-    T value(*reinterpret_cast<const T*>(&raw[0]));
+inline adobe::any_regular_t convert_raw(boost::uint64_t raw) {
+    return adobe::any_regular_t(static_cast<double>(static_cast<T>(raw)));
+}
+
+template <>
+inline adobe::any_regular_t convert_raw<float>(boost::uint64_t raw) {
+    boost::uint32_t bits(static_cast<boost::uint32_t>(raw));
+    float           value;
+
+    std::memcpy(&value, &bits, sizeof(value));
 
     return adobe::any_regular_t(static_cast<double>(value));
 }
 
-inline adobe::any_regular_t convert_raw(const rawbytes_t& raw,
-                                        std::size_t       bit_count,
-                                        atom_base_type_t  base_type) {
+template <>
+inline adobe::any_regular_t convert_raw<double>(boost::uint64_t raw) {
+    double value;
+
+    std::memcpy(&value, &raw, sizeof(value));
+
+    return adobe::any_regular_t(value);
+}
+
+inline adobe::any_regular_t convert_raw(boost::uint64_t  raw,
+                                        std::size_t      bit_count,
+                                        atom_base_type_t base_type) {
     if (base_type == atom_unknown_k) {
         throw std::runtime_error("convert_raw: unknown atom base type");
     } else if (base_type == atom_float_k) {
@@ -92,15 +141,32 @@ public:
 
 /****************************************************************************************************/
 
+// Pops the top two values and pushes the result of op on them, as T.
+template <typename T, typename Operation>
+inline void apply_binary(std::vector<adobe::any_regular_t>& stack, Operation op) {
+    T rhs(stack.back().cast<T>());
+
+    stack.pop_back();
+
+    adobe::any_regular_t& lhs(stack.back());
+
+    lhs = adobe::any_regular_t(op(lhs.cast<T>(), rhs));
+}
+
+/****************************************************************************************************/
+
 struct contextual_evaluation_engine_t {
-    contextual_evaluation_engine_t(const adobe::array_t& expression,
-                                   inspection_branch_t   main_branch,
-                                   inspection_branch_t   current_node,
-                                   bitreader_t&          input);
+    contextual_evaluation_engine_t(inspection_branch_t main_branch,
+                                   inspection_branch_t current_node,
+                                   bitreader_t&        input);
 
-    adobe::any_regular_t evaluate(bool finalize = true);
+    adobe::any_regular_t evaluate(const compiled_expression_t& expression, bool finalize = true);
 
 private:
+    // runs the bytecode; interpret is for expressions that had to fall back to the ASL vm.
+    adobe::any_regular_t execute(const compiled_expression_t& expression);
+    adobe::any_regular_t interpret(const adobe::array_t& expression);
+
     // evaluation vm custom callbacks
     adobe::any_regular_t named_index_lookup(const adobe::any_regular_t& value,
                                             adobe::name_t               name,
@@ -111,23 +177,24 @@ private:
                                                const adobe::array_t& parameter_set);
 
     // helpers
-    inspection_branch_t regular_to_branch(const adobe::any_regular_t& name_or_branch);
-
-    const adobe::array_t& expression_m;
-    inspection_branch_t   main_branch_m;
-    inspection_branch_t   current_node_m;
-    bitreader_t&          input_m;
-    bool                  finalize_m;
+    adobe::any_regular_t index_lookup(const adobe::any_regular_t& value,
+                                      const adobe::any_regular_t& index);
+    adobe::any_regular_t call_builtin(builtin_function_t function,
+                                      const adobe::array_t& parameter_set);
+    inspection_branch_t  regular_to_branch(const adobe::any_regular_t& name_or_branch);
+
+    inspection_branch_t main_branch_m;
+    inspection_branch_t current_node_m;
+    bitreader_t&        input_m;
+    bool                finalize_m;
 };
 
 /****************************************************************************************************/
 
-contextual_evaluation_engine_t::contextual_evaluation_engine_t(const adobe::array_t& expression,
-                                                               inspection_branch_t   main_branch,
-                                                               inspection_branch_t   current_node,
-                                                               bitreader_t&          input)
-    : expression_m(expression), main_branch_m(main_branch), current_node_m(current_node),
-      input_m(input), finalize_m(false) {}
+contextual_evaluation_engine_t::contextual_evaluation_engine_t(inspection_branch_t main_branch,
+                                                               inspection_branch_t current_node,
+                                                               bitreader_t&        input)
+    : main_branch_m(main_branch), current_node_m(current_node), input_m(input), finalize_m(false) {}
 
 /****************************************************************************************************/
 #if 0
@@ -143,35 +210,20 @@ void bad_cast_details(const adobe::bad_cast& error, const std::string& details)
 #endif
 /****************************************************************************************************/
 
-adobe::any_regular_t contextual_evaluation_engine_t::evaluate(bool finalize) try {
-    adobe::virtual_machine_t vm;
-
+adobe::any_regular_t contextual_evaluation_engine_t::evaluate(
+    const compiled_expression_t& expression, bool finalize) try {
     finalize_m = finalize;
 
-    vm.set_variable_lookup(std::bind(&contextual_evaluation_engine_t::stack_variable_lookup,
-                                     std::ref(*this),
-                                     std::placeholders::_1));
-    vm.set_named_index_lookup(std::bind(&contextual_evaluation_engine_t::named_index_lookup,
-                                        std::ref(*this),
-                                        std::placeholders::_1,
-                                        std::placeholders::_2,
-                                        true));
-    vm.set_numeric_index_lookup(std::bind(&contextual_evaluation_engine_t::numeric_index_lookup,
-                                          std::ref(*this),
-                                          std::placeholders::_1,
-                                          std::placeholders::_2));
-    vm.set_array_function_lookup(std::bind(&contextual_evaluation_engine_t::array_function_lookup,
-                                           std::ref(*this),
-                                           std::placeholders::_1,
-                                           std::placeholders::_2));
-
-    vm.evaluate(expression_m);
+    if (interpret_expressions_s)
+        return interpret(expression.source());
 
-    adobe::any_regular_t result(vm.back());
+    if (expression.is_constant())
+        return expression.constant_value();
 
-    vm.pop_back();
+    if (expression.fallback())
+        return interpret(expression.source());
 
-    return result;
+    return execute(expression);
 }
 #if 0
 catch (const adobe::bad_cast& error)
@@ -224,18 +276,218 @@ catch (const std::out_of_range& error) {
 
 /****************************************************************************************************/
 
+adobe::any_regular_t contextual_evaluation_engine_t::execute(
+    const compiled_expression_t& expression) {
+    typedef std::vector<adobe::any_regular_t> value_stack_t;
+
+    // One stack serves every evaluation on the thread, including those nested in a lookup (e.g., of
+    // a const), so each evaluation works above the base it found and pops back to it when done.
+    // Nested evaluations can grow the stack out from under a reference into it; values are popped
+    // into locals before anything that can evaluate.
+    static thread_local value_stack_t stack;
+
+    struct frame_t {
+        ~frame_t() {
+            stack_m.resize(base_m, adobe::any_regular_t());
+        }
+
+        value_stack_t& stack_m;
+        std::size_t    base_m;
+    } frame{stack, stack.size()};
+
+    const std::vector<instruction_t>& code(expression.code());
+    const adobe::array_t&             constants(expression.constants());
+    const std::vector<adobe::name_t>& names(expression.names());
+    std::size_t                       pc(0);
+
+    while (pc != code.size()) {
+        // A lookup or call that ran past the end of the file leaves nothing to go on with.
+        if (end_of_file_s && *end_of_file_s)
+            return adobe::any_regular_t();
+
+        const instruction_t& instruction(code[pc++]);
+
+        switch (instruction.opcode_m) {
+            case op_push_k:
+                stack.push_back(constants[instruction.operand_m]);
+                break;
+            case op_main_k:
+                stack.push_back(adobe::any_regular_t(main_branch_m));
+                break;
+            case op_this_k:
+                stack.push_back(adobe::any_regular_t(current_node_m));
+                break;
+            case op_variable_k: {
+                adobe::any_regular_t value(stack_variable_lookup(names[instruction.operand_m]));
+
+                stack.push_back(std::move(value));
+            } break;
+            case op_subfield_k: {
+                adobe::any_regular_t value(std::move(stack.back()));
+
+                stack.pop_back();
+
+                value = named_index_lookup(value, names[instruction.operand_m], true);
+
+                stack.push_back(std::move(value));
+            } break;
+            case op_index_k: {
+                adobe::any_regular_t index(std::move(stack.back()));
+
+                stack.pop_back();
+
+                adobe::any_regular_t value(std::move(stack.back()));
+
+                stack.pop_back();
+
+                value = index_lookup(value, index);
+
+                stack.push_back(std::move(value));
+            } break;
+            case op_call_k: {
+                value_stack_t::iterator first(stack.end() - instruction.count_m);
+                adobe::array_t          parameter_set(std::make_move_iterator(first),
+                                             std::make_move_iterator(stack.end()));
+
+                stack.erase(first, stack.end());
+
+                adobe::any_regular_t result(call_builtin(
+                    static_cast<builtin_function_t>(instruction.operand_m), parameter_set));
+
+                stack.push_back(std::move(result));
+            } break;
+            case op_array_k: {
+                value_stack_t::iterator first(stack.end() - instruction.count_m);
+                adobe::array_t          array(std::make_move_iterator(first),
+                                     std::make_move_iterator(stack.end()));
+
+                stack.erase(first, stack.end());
+                stack.push_back(adobe::any_regular_t(std::move(array)));
+            } break;
+            case op_add_k:
+                apply_binary<double>(stack, std::plus<double>());
+                break;
+            case op_subtract_k:
+                apply_binary<double>(stack, std::minus<double>());
+                break;
+            case op_multiply_k:
+                apply_binary<double>(stack, std::multiplies<double>());
+                break;
+            case op_divide_k:
+                apply_binary<double>(stack, std::divides<double>());
+                break;
+            case op_modulus_k:
+                apply_binary<double>(stack, [](double x, double y) {
+                    boost::int64_t divisor(static_cast<boost::int64_t>(y));
+
+                    if (divisor == 0)
+                        throw std::runtime_error("modulus by zero");
+
+                    return static_cast<double>(static_cast<boost::int64_t>(x) % divisor);
+                });
+                break;
+            case op_less_k:
+                apply_binary<double>(stack, std::less<double>());
+                break;
+            case op_greater_k:
+                apply_binary<double>(stack, std::greater<double>());
+                break;
+            case op_less_equal_k:
+                apply_binary<double>(stack, std::less_equal<double>());
+                break;
+            case op_greater_equal_k:
+                apply_binary<double>(stack, std::greater_equal<double>());
+                break;
+            case op_equal_k:
+                apply_binary<adobe::any_regular_t>(stack, std::equal_to<adobe::any_regular_t>());
+                break;
+            case op_not_equal_k:
+                apply_binary<adobe::any_regular_t>(stack,
+                                                   std::not_equal_to<adobe::any_regular_t>());
+                break;
+            case op_not_k:
+                stack.back() = adobe::any_regular_t(!stack.back().cast<bool>());
+                break;
+            case op_negate_k:
+                stack.back() = adobe::any_regular_t(-stack.back().cast<double>());
+                break;
+            case op_and_k:
+                if (stack.back().cast<bool>())
+                    stack.pop_back();
+                else
+                    pc = instruction.operand_m;
+                break;
+            case op_or_k:
+                if (stack.back().cast<bool>())
+                    pc = instruction.operand_m;
+                else
+                    stack.pop_back();
+                break;
+            case op_jump_k:
+                pc = instruction.operand_m;
+                break;
+            case op_jump_unless_k: {
+                bool condition(stack.back().cast<bool>());
+
+                stack.pop_back();
+
+                if (!condition)
+                    pc = instruction.operand_m;
+            } break;
+        }
+    }
+
+    return std::move(stack.back());
+}
+
+/****************************************************************************************************/
+
+adobe::any_regular_t contextual_evaluation_engine_t::interpret(const adobe::array_t& expression) {
+    // The virtual machine cannot be stopped partway, so reads past the end of the file throw.
+    temp_assignment<bool*> throwing(end_of_file_s, nullptr);
+    adobe::virtual_machine_t vm;
+
+    vm.set_variable_lookup(std::bind(&contextual_evaluation_engine_t::stack_variable_lookup,
+                                     std::ref(*this),
+                                     std::placeholders::_1));
+    vm.set_named_index_lookup(std::bind(&contextual_evaluation_engine_t::named_index_lookup,
+                                        std::ref(*this),
+                                        std::placeholders::_1,
+                                        std::placeholders::_2,
+                                        true));
+    vm.set_numeric_index_lookup(std::bind(&contextual_evaluation_engine_t::numeric_index_lookup,
+                                          std::ref(*this),
+                                          std::placeholders::_1,
+                                          std::placeholders::_2));
+    vm.set_array_function_lookup(std::bind(&contextual_evaluation_engine_t::array_function_lookup,
+                                           std::ref(*this),
+                                           std::placeholders::_1,
+                                           std::placeholders::_2));
+
+    vm.evaluate(expression);
+
+    adobe::any_regular_t result(vm.back());
+
+    vm.pop_back();
+
+    return result;
+}
+
+/****************************************************************************************************/
+
 adobe::any_regular_t contextual_evaluation_engine_t::named_index_lookup(
     const adobe::any_regular_t& value, adobe::name_t name, bool throwing) {
     inspection_branch_t branch(value.cast<inspection_branch_t>());
 
     if (!branch.equal_node(inspection_branch_t())) {
-        inspection_forest_t::child_iterator iter(adobe::child_begin(branch));
-        inspection_forest_t::child_iterator last(adobe::child_end(branch));
+        inspection_branch_t child(find_child(branch, name));
+
+        // the field may be in a part of the node not yet analyzed
+        if (child.equal_node(inspection_branch_t()) && expand_node(branch))
+            child = find_child(branch, name);
 
-        for (; iter != last; ++iter)
-            if (iter->name_m == name)
-                return finalize_lookup<adobe::any_regular_t>(
-                    main_branch_m, inspection_branch_t(iter.base()), input_m, finalize_m);
+        if (!child.equal_node(inspection_branch_t()))
+            return finalize_lookup<adobe::any_regular_t>(main_branch_m, child, input_m, finalize_m);
     }
 
     if (throwing)
@@ -250,6 +502,37 @@ adobe::any_regular_t contextual_evaluation_engine_t::numeric_index_lookup(
     const adobe::any_regular_t& value, std::size_t index) {
     inspection_branch_t branch(value.cast<inspection_branch_t>());
 
+    if (branch->get_flag(is_implicit_array_k)) {
+        boost::uint64_t size(branch->cardinal_m);
+
+        if (size == 0)
+            throw std::range_error(
+                adobe::make_string("Array '", branch->name_m.c_str(), "' is empty"));
+
+        if (index >= size) {
+            std::stringstream error;
+            error << "Array index " << index << " out of range [ 0 .. " << size - 1
+                  << " ] for array '" << branch->name_m << "'";
+            throw std::range_error(error.str());
+        }
+
+        return finalize_lookup<adobe::any_regular_t>(
+            main_branch_m, array_element(branch, index), input_m, finalize_m);
+    }
+
+    if (branch->element_table_m) {
+        inspection_branch_t element(find_element(branch, index));
+
+        if (element.equal_node(inspection_branch_t())) {
+            std::stringstream error;
+            error << "Array index " << index << " out of range [ 0 .. " << branch->cardinal_m - 1
+                  << " ] for array '" << branch->name_m << "'";
+            throw std::range_error(error.str());
+        }
+
+        return finalize_lookup<adobe::any_regular_t>(main_branch_m, element, input_m, finalize_m);
+    }
+
     if (!adobe::has_children(branch))
         throw std::range_error(adobe::make_string("Array '", branch->name_m.c_str(), "' is empty"));
 
@@ -299,7 +582,7 @@ adobe::any_regular_t contextual_evaluation_engine_t::stack_variable_lookup(adobe
         if (current_node == main_branch_m)
             break;
 
-        current_node = adobe::find_parent(current_node);
+        current_node = parent_of(current_node);
 
         bad_node = current_node.equal_node(inspection_branch_t());
     }
@@ -319,6 +602,22 @@ adobe::any_regular_t contextual_evaluation_engine_t::stack_variable_lookup(adobe
 
 /****************************************************************************************************/
 
+adobe::any_regular_t contextual_evaluation_engine_t::index_lookup(
+    const adobe::any_regular_t& value, const adobe::any_regular_t& index) {
+    if (index.type_info() == typeid(adobe::name_t))
+        return named_index_lookup(value, index.cast<adobe::name_t>(), true);
+
+    std::size_t position(static_cast<std::size_t>(index.cast<double>()));
+
+    // e.g., an array literal
+    if (value.type_info() == typeid(adobe::array_t))
+        return value.cast<adobe::array_t>().at(position);
+
+    return numeric_index_lookup(value, position);
+}
+
+/****************************************************************************************************/
+
 inspection_branch_t contextual_evaluation_engine_t::regular_to_branch(
     const adobe::any_regular_t& name_or_branch) {
     const std::type_info& type(name_or_branch.type_info());
@@ -344,439 +643,459 @@ inspection_branch_t contextual_evaluation_engine_t::regular_to_branch(
 
 /****************************************************************************************************/
 
-namespace {
-
-/****************************************************************************************************/
-
-template <class I>
-void endian_swap(I first, I last) {
-    constexpr auto swapper{[](auto& x){
-        constexpr auto size = sizeof(x);
-        constexpr auto end = size >> 1;
+adobe::any_regular_t contextual_evaluation_engine_t::array_function_lookup(
+    adobe::name_t name, const adobe::array_t& parameter_set) {
+    builtin_function_t function(builtin_function_for(name));
 
-        for (std::size_t i(0); i < end; ++i)
-            std::swap(reinterpret_cast<char*>(&x)[i],
-                      reinterpret_cast<char*>(&x)[size - i - 1]);
-    }};
+    if (function == builtin_unknown_k)
+        throw std::runtime_error(adobe::make_string("Function '", name.c_str(), "' not found"));
 
-    while (first != last) {
-        swapper(*first++);
-    }
+    return call_builtin(function, parameter_set);
 }
 
 /****************************************************************************************************/
 
-} // namespace
+adobe::any_regular_t contextual_evaluation_engine_t::call_builtin(
+    builtin_function_t function, const adobe::array_t& parameter_set) {
+    switch (function) {
+        case builtin_sizeof_k: {
+            if (parameter_set.empty())
+                throw std::runtime_error("sizeof(): @field_name expected");
+
+            inspection_position_t start_offset;
+            inspection_position_t end_offset(invalid_position_k);
+
+            if (parameter_set.size() == 1) {
+                inspection_branch_t leaf(regular_to_branch(parameter_set[0]));
+
+                start_offset = starting_offset_for(leaf);
+                end_offset   = ending_offset_for(leaf);
+            } else if (parameter_set.size() == 2) {
+                inspection_branch_t leaf1(regular_to_branch(parameter_set[0]));
+                inspection_branch_t leaf2(regular_to_branch(parameter_set[1]));
+
+                start_offset = starting_offset_for(leaf1);
+                end_offset   = ending_offset_for(leaf2);
+            } else {
+                throw std::runtime_error("sizeof(): too many parameters");
+            }
 
-/****************************************************************************************************/
+            inspection_position_t size(end_offset - start_offset + inspection_byte_k);
 
-adobe::any_regular_t contextual_evaluation_engine_t::array_function_lookup(
-    adobe::name_t name, const adobe::array_t& parameter_set) {
-    CONSTANT_VALUE(byte);
-    CONSTANT_VALUE(card);
-    CONSTANT_VALUE(endof);
-    CONSTANT_VALUE(indexof);
-    CONSTANT_VALUE(path);
-    CONSTANT_VALUE(peek);
-    CONSTANT_VALUE(print);
-    CONSTANT_VALUE(sizeof);
-    CONSTANT_VALUE(startof);
-    CONSTANT_VALUE(str);
-    CONSTANT_VALUE(strcat);
-    CONSTANT_VALUE(summaryof);
-    CONSTANT_VALUE(fcc);
-    CONSTANT_VALUE(ptoi);
-    CONSTANT_VALUE(padd);
-    CONSTANT_VALUE(psub);
-    CONSTANT_VALUE(itop);
-    CONSTANT_VALUE(itoah); // integer to hex string (c++'s itoa, hex format)
-    CONSTANT_VALUE(gtell);
-    CONSTANT_VALUE(utf16utf8);
-
-    if (name == value_sizeof) {
-        if (parameter_set.empty())
-            throw std::runtime_error("sizeof(): @field_name expected");
-
-        inspection_position_t start_offset;
-        inspection_position_t end_offset(invalid_position_k);
-
-        if (parameter_set.size() == 1) {
-            inspection_branch_t leaf(regular_to_branch(parameter_set[0]));
+            return adobe::any_regular_t(static_cast<double>(size.bytes()));
+        }
+        case builtin_startof_k: {
+            if (parameter_set.empty())
+                throw std::runtime_error("startof(): @field_name expected");
 
-            start_offset = starting_offset_for(leaf);
-            end_offset   = ending_offset_for(leaf);
-        } else if (parameter_set.size() == 2) {
-            inspection_branch_t leaf1(regular_to_branch(parameter_set[0]));
-            inspection_branch_t leaf2(regular_to_branch(parameter_set[1]));
+            inspection_branch_t   leaf(regular_to_branch(parameter_set[0]));
+            inspection_position_t start_offset(starting_offset_for(leaf));
 
-            start_offset = starting_offset_for(leaf1);
-            end_offset   = ending_offset_for(leaf2);
-        } else {
-            throw std::runtime_error("sizeof(): too many parameters");
+            return adobe::any_regular_t(start_offset);
         }
+        case builtin_endof_k: {
+            if (parameter_set.empty())
+                throw std::runtime_error("endof(): @field_name expected");
 
-        inspection_position_t size(end_offset - start_offset + inspection_byte_k);
+            inspection_branch_t   leaf(regular_to_branch(parameter_set[0]));
+            inspection_position_t end_offset(ending_offset_for(leaf));
 
-        return adobe::any_regular_t(static_cast<double>(size.bytes()));
-    } else if (name == value_startof) {
-        if (parameter_set.empty())
-            throw std::runtime_error("startof(): @field_name expected");
+            return adobe::any_regular_t(end_offset);
+        }
+        case builtin_byte_k: {
+            if (parameter_set.empty())
+                throw std::runtime_error("byte(): offset expected");
 
-        inspection_branch_t   leaf(regular_to_branch(parameter_set[0]));
-        inspection_position_t start_offset(starting_offset_for(leaf));
+            const adobe::any_regular_t& argument(parameter_set[0]);
+            inspection_position_t       offset;
 
-        return adobe::any_regular_t(start_offset);
-    } else if (name == value_endof) {
-        if (parameter_set.empty())
-            throw std::runtime_error("endof(): @field_name expected");
+            if (argument.type_info() == typeid(double))
+                offset = bytepos(argument.cast<double>());
+            else // argument.type_info() == inspection_position_t
+                offset = argument.cast<inspection_position_t>();
 
-        inspection_branch_t   leaf(regular_to_branch(parameter_set[0]));
-        inspection_position_t end_offset(ending_offset_for(leaf));
+            if (past_end(input_m, offset, 8))
+                return adobe::any_regular_t();
 
-        return adobe::any_regular_t(end_offset);
-    } else if (name == value_byte) {
-        if (parameter_set.empty())
-            throw std::runtime_error("byte(): offset expected");
+            return adobe::any_regular_t(static_cast<double>(input_m.read_view(offset, 1)[0]));
+        }
+        case builtin_peek_k: {
+            std::size_t byte_count(1);
+            std::size_t param_count(parameter_set.size());
 
-        const adobe::any_regular_t& argument(parameter_set[0]);
-        inspection_position_t       offset;
+            if (param_count > 0)
+                byte_count = static_cast<std::size_t>(parameter_set[0].cast<double>());
 
-        if (argument.type_info() == typeid(double))
-            offset = bytepos(argument.cast<double>());
-        else // argument.type_info() == inspection_position_t
-            offset = argument.cast<inspection_position_t>();
+            restore_point_t restore(input_m);
 
-        input_m.seek(offset);
+            if (past_end(input_m, input_m.pos(), byte_count * 8))
+                return adobe::any_regular_t();
 
-        rawbytes_t buffer(input_m.read(1));
+            if (param_count < 3) {
+                rawview_t buffer(input_m.read_view(byte_count));
 
-        return adobe::any_regular_t(static_cast<double>(buffer[0]));
-    } else if (name == value_peek) {
-        std::size_t byte_count(1);
-        std::size_t param_count(parameter_set.size());
+                return byte_count > 1 ?
+                           adobe::any_regular_t(std::string(buffer.begin(), buffer.end())) :
+                           adobe::any_regular_t(static_cast<double>(buffer[0]));
+            }
 
-        if (param_count > 0)
-            byte_count = static_cast<std::size_t>(parameter_set[0].cast<double>());
+            CONSTANT_VALUE(signed);
+            CONSTANT_VALUE(unsigned);
+            CONSTANT_VALUE(float);
+            CONSTANT_VALUE(big);
+            // CONSTANT_VALUE(little);
+
+            adobe::name_t    type_name = parameter_set[1].cast<adobe::name_t>();
+            adobe::name_t    endian_name = parameter_set[2].cast<adobe::name_t>();
+            atom_base_type_t type = type_name == value_signed ?   atom_signed_k :
+                                    type_name == value_unsigned ? atom_unsigned_k :
+                                    type_name == value_float ?    atom_float_k :
+                                                                  atom_unknown_k;
+            bool             endian = endian_name == value_big;
+
+            return convert_raw(input_m.read_uint(byte_count * 8, endian), byte_count * 8, type);
+        }
+        case builtin_card_k: {
+            if (parameter_set.empty())
+                throw std::runtime_error("card(): @field_name expected");
 
-        rawbytes_t buffer;
+            inspection_branch_t array(regular_to_branch(parameter_set[0]));
 
-        {
-            restore_point_t restore(input_m);
+            if (!array->get_flag(is_array_root_k))
+                throw std::runtime_error("card(): field is not an array");
 
-            buffer = input_m.read(byte_count);
+            return adobe::any_regular_t(
+                static_cast<double>(node_property(array, ARRAY_ROOT_PROPERTY_SIZE)));
         }
+        case builtin_print_k: {
+            // should be a printf-like behavior, to be able to output numbers etc.
 
-        if (param_count < 3)
-            return byte_count > 1 ? adobe::any_regular_t(std::string(buffer.begin(), buffer.end())) :
-                                    adobe::any_regular_t(static_cast<double>(buffer[0]));
+            if (parameter_set.empty())
+                throw std::runtime_error("print(): argument required");
 
-        CONSTANT_VALUE(signed);
-        CONSTANT_VALUE(unsigned);
-        CONSTANT_VALUE(float);
-        CONSTANT_VALUE(big);
-        // CONSTANT_VALUE(little);
+            std::string result;
 
-        adobe::name_t    type_name = parameter_set[1].cast<adobe::name_t>();
-        adobe::name_t    endian_name = parameter_set[2].cast<adobe::name_t>();
-        atom_base_type_t type = type_name == value_signed ?   atom_signed_k :
-                                type_name == value_unsigned ? atom_unsigned_k :
-                                type_name == value_float ?    atom_float_k :
-                                                              atom_unknown_k;
-        bool             endian = endian_name == value_big;
+            for (adobe::array_t::const_iterator iter(parameter_set.begin()),
+                 last(parameter_set.end());
+                 iter != last;
+                 ++iter) {
+                const std::type_info& type(iter->type_info());
 
-        return ::evaluate(buffer, buffer.size() * 8, type, endian);
-    } else if (name == value_card) {
-        if (parameter_set.empty())
-            throw std::runtime_error("card(): @field_name expected");
-
-        inspection_branch_t array(regular_to_branch(parameter_set[0]));
+                if (type == typeid(double))
+                    result += boost::lexical_cast<std::string>(iter->cast<double>());
+                else if (type == typeid(std::string))
+                    result += iter->cast<std::string>();
+                else
+                    result += type.name();
+            }
 
-        if (!array->get_flag(is_array_root_k))
-            throw std::runtime_error("card(): field is not an array");
+            return adobe::any_regular_t(result);
+        }
+        case builtin_strcat_k: {
+            if (parameter_set.empty())
+                throw std::runtime_error("strcat(): argument required");
 
-        return adobe::any_regular_t(
-            static_cast<double>(node_property(array, ARRAY_ROOT_PROPERTY_SIZE)));
-    } else if (name == value_print) {
-        // should be a printf-like behavior, to be able to output numbers etc.
+            std::string result;
 
-        if (parameter_set.empty())
-            throw std::runtime_error("print(): argument required");
+            for (adobe::array_t::const_iterator iter(parameter_set.begin()),
+                 last(parameter_set.end());
+                 iter != last;
+                 ++iter)
+                result += iter->cast<std::string>();
 
-        std::string result;
+            return adobe::any_regular_t(result);
+        }
+        case builtin_summaryof_k: {
+            if (parameter_set.size() != 1)
+                throw std::runtime_error("summaryof(): takes one argument");
 
-        for (adobe::array_t::const_iterator iter(parameter_set.begin()), last(parameter_set.end());
-             iter != last;
-             ++iter) {
-            const std::type_info& type(iter->type_info());
+            return adobe::any_regular_t(
+                summary_of(main_branch_m, regular_to_branch(parameter_set[0]), input_m));
+        }
+        case builtin_str_k: {
+            if (parameter_set.empty())
+                throw std::runtime_error("str(): @field_name expected");
+
+            inspection_branch_t   leaf(regular_to_branch(parameter_set[0]));
+            inspection_position_t start_offset(starting_offset_for(leaf));
+            inspection_position_t end_offset(ending_offset_for(leaf));
+            inspection_position_t size(end_offset - start_offset + inspection_byte_k);
+
+            if (node_property(leaf, NODE_PROPERTY_IS_CONST))
+                throw std::runtime_error("str(): cannot take the string of a const");
+
+            if (past_end(input_m, start_offset, size.bytes() * 8))
+                return adobe::any_regular_t();
+
+            rawview_t   view(input_m.read_view(start_offset, size.bytes()));
+            std::string str(view.begin(), view.end());
+
+            // This is a workaround I'm still not sure about; in the cases when we
+            // obtain an array with the terminator: construct the terminator is
+            // included. In the case of a null-terminated c-string we consider it
+            // part of the array but do not want it included in the string_t. As
+            // such we have a general exception case here where if the final
+            // character of the string is 0 it is excluded.
+            if (!str.empty() && str.back() == 0)
+                str.pop_back();
+
+            // If we have an atom that isn't an array root and it's little endian,
+            // we need to reverse the contents.
+            if (node_property(leaf, NODE_PROPERTY_IS_ATOM) &&
+                !node_property(leaf, ATOM_PROPERTY_IS_BIG_ENDIAN) &&
+                !leaf->get_flag(is_array_root_k)) {
+                adobe::reverse(str);
+            }
 
-            if (type == typeid(double))
-                result += boost::lexical_cast<std::string>(iter->cast<double>());
-            else if (type == typeid(std::string))
-                result += iter->cast<std::string>();
-            else
-                result += type.name();
+            return adobe::any_regular_t(std::move(str));
         }
+        case builtin_path_k: {
+            adobe::any_regular_t path("this"_name);
 
-        return adobe::any_regular_t(result);
-    } else if (name == value_strcat) {
-        if (parameter_set.empty())
-            throw std::runtime_error("strcat(): argument required");
+            if (!parameter_set.empty())
+                path = parameter_set[0];
 
-        std::string result;
+            inspection_branch_t leaf(regular_to_branch(path));
 
-        for (adobe::array_t::const_iterator iter(parameter_set.begin()), last(parameter_set.end());
-             iter != last;
-             ++iter)
-            result += iter->cast<std::string>();
+            return adobe::any_regular_t(std::string(build_path(main_branch_m, leaf)));
+        }
+        case builtin_indexof_k: {
+            adobe::any_regular_t path("this"_name);
 
-        return adobe::any_regular_t(result);
-    } else if (name == value_summaryof) {
-        if (parameter_set.size() != 1)
-            throw std::runtime_error("summaryof(): takes one argument");
+            if (!parameter_set.empty())
+                path = parameter_set[0];
 
-        return adobe::any_regular_t(regular_to_branch(parameter_set[0])->summary_m);
-    } else if (name == value_str) {
-        if (parameter_set.empty())
-            throw std::runtime_error("str(): @field_name expected");
+            inspection_branch_t leaf(regular_to_branch(path));
 
-        inspection_branch_t   leaf(regular_to_branch(parameter_set[0]));
-        inspection_position_t start_offset(starting_offset_for(leaf));
-        inspection_position_t end_offset(ending_offset_for(leaf));
-        inspection_position_t size(end_offset - start_offset + inspection_byte_k);
+            if (!leaf->get_flag(is_array_element_k)) {
+                adobe::name_t     name(node_property(leaf, NODE_PROPERTY_NAME));
+                std::stringstream error;
+                error << "indexof(): field '" << name << "' is not an array element";
+                throw std::runtime_error(error.str());
+            }
 
-        if (node_property(leaf, NODE_PROPERTY_IS_CONST))
-            throw std::runtime_error("str(): cannot take the string of a const");
+            return adobe::any_regular_t(
+                static_cast<double>(node_value(leaf, ARRAY_ELEMENT_VALUE_INDEX)));
+        }
+        case builtin_fcc_k: {
+            // converts an N character-code (commonly a four character code) to its
+            // integer equivalent.
 
-        input_m.seek(start_offset);
+            if (parameter_set.empty())
+                throw std::runtime_error("fcc(): character code expected");
 
-        rawbytes_t str(input_m.read(size.bytes()));
+            std::string fcc(parameter_set[0].cast<std::string>());
+            std::size_t length(fcc.size());
 
-        // This is a workaround I'm still not sure about; in the cases when we
-        // obtain an array with the terminator: construct the terminator is
-        // included. In the case of a null-terminated c-string we consider it
-        // part of the array but do not want it included in the string_t. As
-        // such we have a general exception case here where if the final
-        // character of the string is 0 it is excluded.
+            if (length > 4)
+                throw std::runtime_error("fcc(): character code too long.");
 
-        std::size_t strsize(str.size());
+            boost::uint32_t value(0);
 
-        if (strsize && str[strsize - 1] == 0)
-            str.resize(strsize - 1);
+            for (std::size_t i(0); i < length; ++i)
+                value = (value << 8) | fcc[i];
 
-        // If we have an atom that isn't an array root and it's little endian,
-        // we need to reverse the contents.
-        if (node_property(leaf, NODE_PROPERTY_IS_ATOM) &&
-            !node_property(leaf, ATOM_PROPERTY_IS_BIG_ENDIAN) && !leaf->get_flag(is_array_root_k)) {
-            adobe::reverse(str);
+            return adobe::any_regular_t(value);
         }
+        case builtin_ptoi_k: {
+            // converts the bytes portion of a pos_t to a double
 
-        return adobe::any_regular_t(std::string(str.begin(), str.end()));
-    } else if (name == value_path) {
-        adobe::any_regular_t path("this"_name);
-
-        if (!parameter_set.empty())
-            path = parameter_set[0];
+            if (parameter_set.empty())
+                throw std::runtime_error("ptoi(): position required");
 
-        inspection_branch_t leaf(regular_to_branch(path));
+            const adobe::any_regular_t& argument(parameter_set[0]);
 
-        return adobe::any_regular_t(std::string(build_path(main_branch_m, leaf)));
-    } else if (name == value_indexof) {
-        adobe::any_regular_t path("this"_name);
+            if (argument.type_info() != typeid(inspection_position_t))
+                throw std::runtime_error("ptoi(): bad parameter type (expects a position)");
 
-        if (!parameter_set.empty())
-            path = parameter_set[0];
+            // NOTE (fbrereto) : 64->32 truncation!
+            boost::uint32_t value(argument.cast<inspection_position_t>().bytes());
 
-        inspection_branch_t leaf(regular_to_branch(path));
-
-        if (!leaf->get_flag(is_array_element_k)) {
-            adobe::name_t     name(node_property(leaf, NODE_PROPERTY_NAME));
-            std::stringstream error;
-            error << "indexof(): field '" << name << "' is not an array element";
-            throw std::runtime_error(error.str());
+            return adobe::any_regular_t(value);
         }
+        case builtin_itoah_k: {
+            // converts the value to a string in hex
 
-        return adobe::any_regular_t(
-            static_cast<double>(node_value(leaf, ARRAY_ELEMENT_VALUE_INDEX)));
-    } else if (name == value_fcc) {
-        // converts an N character-code (commonly a four character code) to its
-        // integer equivalent.
-
-        if (parameter_set.empty())
-            throw std::runtime_error("fcc(): character code expected");
-
-        std::string fcc(parameter_set[0].cast<std::string>());
-        std::size_t length(fcc.size());
-
-        if (length > 4)
-            throw std::runtime_error("fcc(): character code too long.");
+            if (parameter_set.empty())
+                throw std::runtime_error("itoah(): integer required");
 
-        boost::uint32_t value(0);
+            const adobe::any_regular_t& argument(parameter_set[0]);
 
-        for (std::size_t i(0); i < length; ++i)
-            value = (value << 8) | fcc[i];
+            if (argument.type_info() != typeid(double))
+                throw std::runtime_error("itoah(): bad parameter type (expects an integer)");
 
-        return adobe::any_regular_t(value);
-    } else if (name == value_ptoi) {
-        // converts the bytes portion of a pos_t to a double
+            std::stringstream ss;
+            ss << std::hex << static_cast<std::size_t>(argument.cast<double>());
+            auto s{ss.str()};
 
-        if (parameter_set.empty())
-            throw std::runtime_error("ptoi(): position required");
+            std::transform(s.begin(), s.end(), s.begin(), [](auto c){ return std::toupper(c); });
 
-        const adobe::any_regular_t& argument(parameter_set[0]);
+            return adobe::any_regular_t("0x" + s);
+        }
+        case builtin_itop_k: {
+            // converts the bytes portion of a pos_t to a double
 
-        if (argument.type_info() != typeid(inspection_position_t))
-            throw std::runtime_error("ptoi(): bad parameter type (expects a position)");
+            if (parameter_set.empty())
+                throw std::runtime_error("itop(): position required");
 
-        // NOTE (fbrereto) : 64->32 truncation!
-        boost::uint32_t value(argument.cast<inspection_position_t>().bytes());
+            const adobe::any_regular_t& argument(parameter_set[0]);
 
-        return adobe::any_regular_t(value);
-    } else if (name == value_itoah) {
-        // converts the value to a string in hex
+            if (argument.type_info() != typeid(double))
+                throw std::runtime_error("itop(): bad parameter type (expects an integer)");
 
-        if (parameter_set.empty())
-            throw std::runtime_error("itoah(): integer required");
+            inspection_position_t value(bytepos(argument.cast<double>()));
 
-        const adobe::any_regular_t& argument(parameter_set[0]);
+            return adobe::any_regular_t(value);
+        }
+        case builtin_padd_k: {
+            // adds N values (position and/or double) and returns a position
+
+            if (parameter_set.empty())
+                throw std::runtime_error("padd(): argument required");
+
+            inspection_position_t result;
+
+            for (adobe::array_t::const_iterator iter(parameter_set.begin()),
+                 last(parameter_set.end());
+                 iter != last;
+                 ++iter) {
+                if (iter->type_info() == typeid(double))
+                    result += bytepos(iter->cast<double>());
+                else if (iter->type_info() == typeid(inspection_position_t))
+                    result += iter->cast<inspection_position_t>();
+                else
+                    throw std::runtime_error(
+                        "padd() : type of argument must be position or double");
+            }
 
-        if (argument.type_info() != typeid(double))
-            throw std::runtime_error("itoah(): bad parameter type (expects an integer)");
+            return adobe::any_regular_t(result);
+        }
+        case builtin_psub_k: {
+            // subs 2 values (position and/or double) and returns a position
 
-        std::stringstream ss;
-        ss << std::hex << static_cast<std::size_t>(argument.cast<double>());
-        auto s{ss.str()};
+            if (parameter_set.size() != 2)
+                throw std::runtime_error("psub(): exactly 2 arguments required");
 
-        std::transform(s.begin(), s.end(), s.begin(), [](auto c){ return std::toupper(c); });
+            inspection_position_t       result;
+            const adobe::any_regular_t& op1(parameter_set[0]);
+            const adobe::any_regular_t& op2(parameter_set[1]);
 
-        return adobe::any_regular_t("0x" + s);
-    }  else if (name == value_itop) {
-        // converts the bytes portion of a pos_t to a double
+            if (op1.type_info() == typeid(double))
+                result += bytepos(op1.cast<double>());
+            else if (op1.type_info() == typeid(inspection_position_t))
+                result += op1.cast<inspection_position_t>();
+            else
+                throw std::runtime_error("psub() : first argument must be position or double");
 
-        if (parameter_set.empty())
-            throw std::runtime_error("itop(): position required");
+            if (op2.type_info() == typeid(double))
+                result -= bytepos(op2.cast<double>());
+            else if (op2.type_info() == typeid(inspection_position_t))
+                result -= op2.cast<inspection_position_t>();
+            else
+                throw std::runtime_error("psub() : second argument must be position or double");
 
-        const adobe::any_regular_t& argument(parameter_set[0]);
+            return adobe::any_regular_t(result);
+        }
+        case builtin_gtell_k: {
+            // returns the current read head position
+            return adobe::any_regular_t(input_m.pos());
+        }
+        case builtin_utf16utf8_k: {
+            if (parameter_set.empty())
+                throw std::runtime_error("utf16utf8(): @field_name expected");
 
-        if (argument.type_info() != typeid(double))
-            throw std::runtime_error("itop(): bad parameter type (expects an integer)");
+            inspection_branch_t leaf(regular_to_branch(parameter_set[0]));
 
-        inspection_position_t value(bytepos(argument.cast<double>()));
+            if (node_property(leaf, NODE_PROPERTY_IS_CONST))
+                throw std::runtime_error("utf16utf8(): cannot take the string of a const");
 
-        return adobe::any_regular_t(value);
-    } else if (name == value_padd) {
-        // adds N values (position and/or double) and returns a position
+            inspection_position_t start_offset(starting_offset_for(leaf));
+            inspection_position_t end_offset(ending_offset_for(leaf));
+            inspection_position_t size(end_offset - start_offset + inspection_byte_k);
+            std::size_t byte_count{size.bytes()};
+            std::size_t utf16_code_count{byte_count / 2};
 
-        if (parameter_set.empty())
-            throw std::runtime_error("padd(): argument required");
+            bool is_big_endian(node_property(leaf, ATOM_PROPERTY_IS_BIG_ENDIAN));
 
-        inspection_position_t result;
+            if (past_end(input_m, start_offset, byte_count * 8))
+                return adobe::any_regular_t();
 
-        for (adobe::array_t::const_iterator iter(parameter_set.begin()), last(parameter_set.end());
-             iter != last;
-             ++iter) {
-            if (iter->type_info() == typeid(double))
-                result += bytepos(iter->cast<double>());
-            else if (iter->type_info() == typeid(inspection_position_t))
-                result += iter->cast<inspection_position_t>();
-            else
-                throw std::runtime_error("padd() : type of argument must be position or double");
-        }
+            rawview_t                  raw(input_m.read_view(start_offset, byte_count));
+            const boost::uint8_t*      p(raw.begin());
+            std::vector<std::uint16_t> utf16(utf16_code_count);
 
-        return adobe::any_regular_t(result);
-    } else if (name == value_psub) {
-        // subs 2 values (position and/or double) and returns a position
+            // assemble the code units in host order straight out of the view.
+            for (auto& unit : utf16) {
+                unit = is_big_endian ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+                p += 2;
+            }
 
-        if (parameter_set.size() != 2)
-            throw std::runtime_error("psub(): exactly 2 arguments required");
+            std::string utf8;
+            adobe::copy_utf<std::uint8_t>(utf16.begin(), utf16.end(), std::back_inserter(utf8));
 
-        inspection_position_t       result;
-        const adobe::any_regular_t& op1(parameter_set[0]);
-        const adobe::any_regular_t& op2(parameter_set[1]);
+            // chomp a null terminator if there is one.
+            if (!utf8.empty() && utf8.back() == 0)
+                utf8.pop_back();
 
-        if (op1.type_info() == typeid(double))
-            result += bytepos(op1.cast<double>());
-        else if (op1.type_info() == typeid(inspection_position_t))
-            result += op1.cast<inspection_position_t>();
-        else
-            throw std::runtime_error("psub() : first argument must be position or double");
-
-        if (op2.type_info() == typeid(double))
-            result -= bytepos(op2.cast<double>());
-        else if (op2.type_info() == typeid(inspection_position_t))
-            result -= op2.cast<inspection_position_t>();
-        else
-            throw std::runtime_error("psub() : second argument must be position or double");
-
-        return adobe::any_regular_t(result);
-    } else if (name == value_gtell) {
-        // returns the current read head position
-        return adobe::any_regular_t(input_m.pos());
-    } else if (name == value_utf16utf8) {
-        if (parameter_set.empty())
-            throw std::runtime_error("utf16utf8(): @field_name expected");
-
-        inspection_branch_t leaf(regular_to_branch(parameter_set[0]));
-
-        if (node_property(leaf, NODE_PROPERTY_IS_CONST))
-            throw std::runtime_error("utf16utf8(): cannot take the string of a const");
-
-        inspection_position_t start_offset(starting_offset_for(leaf));
-        inspection_position_t end_offset(ending_offset_for(leaf));
-        inspection_position_t size(end_offset - start_offset + inspection_byte_k);
-        std::size_t byte_count{size.bytes()};
-        std::size_t utf16_code_count{byte_count / 2};
-
-        input_m.seek(start_offset);
-
-        rawbytes_t str(input_m.read(size.bytes()));
-        std::uint16_t* utf16_first{reinterpret_cast<std::uint16_t*>(&str[0])};
-        std::uint16_t* utf16_last{utf16_first + utf16_code_count};
-
-        // REVISIT: (fbrereto) The ability to get pointers to non-byte-sized atoms
-        // that are properly swapped should be made generally available.
-        // e.g. std::pair<T*, T*> transform_raw(rawbytes_t& raw);
-        // then called like:
-        // auto utf16_range = transform_raw<std::uint16_t>(raw);
-#if BINSPECTOR_ENDIAN_LITTLE
-        if (node_property(leaf, ATOM_PROPERTY_IS_BIG_ENDIAN))
-            endian_swap(utf16_first, utf16_last);
-#else
-        if (!node_property(leaf, ATOM_PROPERTY_IS_BIG_ENDIAN))
-            endian_swap(utf16_first, utf16_last);
-#endif
+            return adobe::any_regular_t(std::move(utf8));
+        }
+        default:
+            break;
+    }
 
-        std::string utf8;
-        adobe::copy_utf<std::uint8_t>(utf16_first, utf16_last, std::back_inserter(utf8));
+    throw std::runtime_error("Unknown built-in function");
+}
 
-        // chomp a null terminator if there is one.
-        if (!utf8.empty() && utf8.back() == 0)
-            utf8.pop_back();
+/****************************************************************************************************/
 
-        return adobe::any_regular_t(std::move(utf8));
-    }
+// Evaluates with end_of_file_s set to end_of_file: null to throw at the end of the file, as the
+// bitreader does, or where to note it instead.
+adobe::any_regular_t evaluate_reporting(const compiled_expression_t& expression,
+                                        inspection_branch_t          main_branch,
+                                        inspection_branch_t          current_node,
+                                        bitreader_t&                 input,
+                                        bool*                        end_of_file) {
+    temp_assignment<bool*> reporting(end_of_file_s, end_of_file);
 
-    throw std::runtime_error(adobe::make_string("Function '", name.c_str(), "' not found"));
+    return contextual_evaluation_engine_t(main_branch, current_node, input).evaluate(expression);
 }
 
 /****************************************************************************************************/
 
 } // namespace
 
+/****************************************************************************************************/
+
+void set_interpret_expressions(bool interpret) {
+    interpret_expressions_s = interpret;
+}
+
 /****************************************************************************************************/
 #if 0
 #pragma mark -
 #endif
 /****************************************************************************************************/
 
+adobe::any_regular_t evaluate(const rawview_t& raw,
+                              boost::uint64_t  bit_count,
+                              atom_base_type_t base_type,
+                              bool             is_big_endian) {
+    // Atoms are at most 64 bits wide.
+    if (raw.size() > sizeof(boost::uint64_t))
+        throw std::runtime_error("convert_raw: invalid bit count");
+
+    return convert_raw(
+        uint_from_bytes(raw.begin(), raw.size(), is_big_endian), bit_count, base_type);
+}
+
+/****************************************************************************************************/
+
 adobe::any_regular_t evaluate(const rawbytes_t& raw,
                               boost::uint64_t   bit_count,
                               atom_base_type_t  base_type,
                               bool              is_big_endian) {
-    rawbytes_t byte_set(raw);
-
-    host_to_endian(byte_set, is_big_endian);
-
-    return convert_raw(byte_set, bit_count, base_type);
+    return evaluate(
+        rawview_t(raw.data(), raw.data() + raw.size()), bit_count, base_type, is_big_endian);
 }
 
 /****************************************************************************************************/
@@ -786,7 +1105,26 @@ adobe::any_regular_t fetch_and_evaluate(bitreader_t&                 input,
                                         boost::uint64_t              bit_count,
                                         atom_base_type_t             base_type,
                                         bool                         is_big_endian) {
-    return evaluate(input.read_bits(location, bit_count), bit_count, base_type, is_big_endian);
+    return convert_raw(input.read_uint(location, bit_count, is_big_endian), bit_count, base_type);
+}
+
+/****************************************************************************************************/
+
+adobe::any_regular_t declared_value_of(inspection_branch_t main,
+                                       inspection_branch_t branch,
+                                       bitreader_t&        input) {
+    // Note (fbrereto): Evaluate at the point of the const declaration,
+    //                  not at the current branch.
+    // The end of the file is reported or thrown as it is for the evaluation that looked it up.
+    if (branch->compiled_expression_m)
+        return evaluate_reporting(
+            *branch->compiled_expression_m, main, parent_of(branch), input, end_of_file_s);
+
+    return evaluate_reporting(compiled_expression_t(branch->expression_m),
+                              main,
+                              parent_of(branch),
+                              input,
+                              end_of_file_s);
 }
 
 /****************************************************************************************************/
@@ -813,15 +1151,24 @@ adobe::any_regular_t finalize_lookup(inspection_branch_t root,
                node_property(branch, NODE_PROPERTY_IS_STRUCT)) {
         // do nothing
     } else if (node_property(branch, NODE_PROPERTY_IS_ATOM)) {
-        atom_base_type_t      base_type(node_property(branch, ATOM_PROPERTY_BASE_TYPE));
-        bool                  is_big_endian(node_property(branch, ATOM_PROPERTY_IS_BIG_ENDIAN));
-        boost::uint64_t       bit_count(node_property(branch, ATOM_PROPERTY_BIT_COUNT));
-        inspection_position_t position(node_value(branch, ATOM_VALUE_LOCATION));
-
-        // REVISIT (fbrereto) : Is there any reason why we wouldn't want to cache
-        //                      the value of an atom like we do a const or slot?
+        // The file doesn't change under us, so an atom is read and decoded once and cached the
+        // same way as a const. (use_count_m above still counts every lookup.)
+        if (!branch->evaluated_m) {
+            atom_base_type_t      base_type(node_property(branch, ATOM_PROPERTY_BASE_TYPE));
+            bool                  is_big_endian(node_property(branch, ATOM_PROPERTY_IS_BIG_ENDIAN));
+            boost::uint64_t       bit_count(node_property(branch, ATOM_PROPERTY_BIT_COUNT));
+            inspection_position_t position(node_value(branch, ATOM_VALUE_LOCATION));
+
+            // not cached: an edit may have made the file long enough since; see reanalyze
+            if (past_end(input, position, bit_count))
+                return adobe::any_regular_t();
+
+            branch->evaluated_value_m =
+                fetch_and_evaluate(input, position, bit_count, base_type, is_big_endian);
+            branch->evaluated_m = true;
+        }
 
-        result = fetch_and_evaluate(input, position, bit_count, base_type, is_big_endian);
+        result = branch->evaluated_value_m;
     } else if (node_property(branch, NODE_PROPERTY_IS_CONST) ||
                node_property(branch, NODE_PROPERTY_IS_SLOT)) {
         // We handle slots and consts the same way; at the time a signal is fired for the slot
@@ -829,13 +1176,14 @@ adobe::any_regular_t finalize_lookup(inspection_branch_t root,
 
         if (node_value(branch, CONST_VALUE_IS_EVALUATED) == false) {
             try {
-                const adobe::array_t& const_expression(node_value(branch, CONST_VALUE_EXPRESSION));
+                adobe::any_regular_t value(declared_value_of(root, branch, input));
+
+                // nothing to cache; the evaluation that looked it up stops here, too
+                if (end_of_file_s && *end_of_file_s)
+                    return adobe::any_regular_t();
 
-                // Note (fbrereto): Evaluate at the point of the const declaration,
-                //                  not at the current branch.
-                branch->evaluated_value_m = contextual_evaluation_of<adobe::any_regular_t>(
-                    const_expression, root, adobe::find_parent(branch), input);
-                branch->evaluated_m = true;
+                branch->evaluated_value_m = std::move(value);
+                branch->evaluated_m       = true;
             } catch (const std::exception& error) {
                 // This pads out the current error with the location of the
                 // expression being evaluated, hopefully giving the user a
@@ -867,12 +1215,33 @@ adobe::any_regular_t finalize_lookup(inspection_branch_t root,
 
 /****************************************************************************************************/
 
+template <>
+adobe::any_regular_t contextual_evaluation_of(const compiled_expression_t& expression,
+                                              inspection_branch_t          main_branch,
+                                              inspection_branch_t          current_node,
+                                              bitreader_t&                 input) {
+    return evaluate_reporting(expression, main_branch, current_node, input, nullptr);
+}
+
+template <>
+inspection_branch_t contextual_evaluation_of(const compiled_expression_t& expression,
+                                             inspection_branch_t          main_branch,
+                                             inspection_branch_t          current_node,
+                                             bitreader_t&                 input) {
+    temp_assignment<bool*> throwing(end_of_file_s, nullptr);
+
+    return contextual_evaluation_engine_t(main_branch, current_node, input)
+        .evaluate(expression, false)
+        .cast<inspection_branch_t>();
+}
+
 template <>
 adobe::any_regular_t contextual_evaluation_of(const adobe::array_t& expression,
                                               inspection_branch_t   main_branch,
                                               inspection_branch_t   current_node,
                                               bitreader_t&          input) {
-    return contextual_evaluation_engine_t(expression, main_branch, current_node, input).evaluate();
+    return contextual_evaluation_of<adobe::any_regular_t>(
+        compiled_expression_t(expression), main_branch, current_node, input);
 }
 
 template <>
@@ -880,9 +1249,20 @@ inspection_branch_t contextual_evaluation_of(const adobe::array_t& expression,
                                              inspection_branch_t   main_branch,
                                              inspection_branch_t   current_node,
                                              bitreader_t&          input) {
-    return contextual_evaluation_engine_t(expression, main_branch, current_node, input)
-        .evaluate(false)
-        .cast<inspection_branch_t>();
+    return contextual_evaluation_of<inspection_branch_t>(
+        compiled_expression_t(expression), main_branch, current_node, input);
+}
+
+/****************************************************************************************************/
+
+adobe::any_regular_t contextual_evaluation_of(const compiled_expression_t& expression,
+                                              inspection_branch_t          main_branch,
+                                              inspection_branch_t          current_node,
+                                              bitreader_t&                 input,
+                                              bool&                        end_of_file) {
+    end_of_file = false;
+
+    return evaluate_reporting(expression, main_branch, current_node, input, &end_of_file);
 }
 
 /****************************************************************************************************/
@@ -914,6 +1294,47 @@ inspection_position_t ending_offset_for(inspection_branch_t branch) {
 
 /****************************************************************************************************/
 
+const std::string& summary_of(inspection_branch_t main,
+                              inspection_branch_t branch,
+                              bitreader_t&        input) {
+    // the summary may be set by a part of the node not yet analyzed
+    expand_node(branch);
+
+    if (!branch->summary_expression_m || branch->get_flag(is_summary_rendered_k))
+        return branch->summary_m;
+
+    adobe::array_t argument_set;
+
+    {
+        restore_point_t restore_point(input);
+
+        argument_set = contextual_evaluation_of<adobe::array_t>(
+            *branch->summary_expression_m, main, branch, input);
+    }
+
+    std::stringstream result;
+
+    // REVISIT (fbrereto) : I would like to be able to specify a serialization routien
+    //                      for inspection_branch_t at this point, so I don't have to
+    //                      do this kind of manual looping, however changes will need
+    //                      to go into ASL to make that happen, so this is a bit of a
+    //                      hack.
+    for (const auto& entry : argument_set) {
+        if (entry.type_info() == typeid(inspection_branch_t)) {
+            result << summary_of(main, entry.cast<inspection_branch_t>(), input);
+        } else {
+            result << entry;
+        }
+    }
+
+    branch->summary_m = result.str();
+    branch->set_flag(is_summary_rendered_k);
+
+    return branch->summary_m;
+}
+
+/****************************************************************************************************/
+
 std::string build_path(const_inspection_branch_t main, const_inspection_branch_t current) {
 #if !BOOST_WINDOWS
     using std::isalpha;
@@ -947,7 +1368,7 @@ std::string build_path(const_inspection_branch_t main, const_inspection_branch_t
         if (current == main)
             break;
 
-        current = adobe::find_parent(current);
+        current = parent_of(current);
     }
 
     std::string result;
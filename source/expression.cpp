@@ -0,0 +1,456 @@
+/*
+    Copyright 2014 Adobe
+    Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+*/
+/****************************************************************************************************/
+
+// identity
+#include <binspector/expression.hpp>
+
+// asl
+#include <adobe/closed_hash.hpp>
+#include <adobe/implementation/token.hpp>
+
+// application
+#include <binspector/common.hpp>
+
+/****************************************************************************************************/
+
+namespace {
+
+/****************************************************************************************************/
+
+// Thrown while compiling when the expression uses something the bytecode does not cover.
+struct unsupported_t {};
+
+/****************************************************************************************************/
+
+struct operator_t {
+    opcode_t    opcode_m;
+    std::size_t arity_m; // the count of terms the operator consumes, or 0 for op_array_k
+};
+
+typedef adobe::closed_hash_map<adobe::name_t, operator_t> operator_map_t;
+
+const operator_map_t& operator_map() {
+    static const operator_map_t map_s([]() {
+        operator_map_t result;
+
+        // The operands of .and and .or are a value and an expression to evaluate if needed; those
+        // of .ifelse are a condition and two such expressions.
+        result[adobe::and_k]           = operator_t{op_and_k, 2};
+        result[adobe::or_k]            = operator_t{op_or_k, 2};
+        result[adobe::ifelse_k]        = operator_t{op_jump_unless_k, 3};
+        result[adobe::variable_k]      = operator_t{op_variable_k, 1};
+        result[adobe::index_k]         = operator_t{op_index_k, 2};
+        result[adobe::function_k]      = operator_t{op_call_k, 2};
+        result[adobe::array_k]         = operator_t{op_array_k, 0};
+        result[adobe::add_k]           = operator_t{op_add_k, 2};
+        result[adobe::subtract_k]      = operator_t{op_subtract_k, 2};
+        result[adobe::multiply_k]      = operator_t{op_multiply_k, 2};
+        result[adobe::divide_k]        = operator_t{op_divide_k, 2};
+        result[adobe::modulus_k]       = operator_t{op_modulus_k, 2};
+        result[adobe::less_k]          = operator_t{op_less_k, 2};
+        result[adobe::greater_k]       = operator_t{op_greater_k, 2};
+        result[adobe::less_equal_k]    = operator_t{op_less_equal_k, 2};
+        result[adobe::greater_equal_k] = operator_t{op_greater_equal_k, 2};
+        result[adobe::equal_k]         = operator_t{op_equal_k, 2};
+        result[adobe::not_equal_k]     = operator_t{op_not_equal_k, 2};
+        result[adobe::not_k]           = operator_t{op_not_k, 1};
+        result[adobe::unary_negate_k]  = operator_t{op_negate_k, 1};
+
+        return result;
+    }());
+
+    return map_s;
+}
+
+/****************************************************************************************************/
+
+// The expression parser emits postfix: every operator follows its operands, and any name that is
+// not an operator is a literal. The compiler walks that backwards to find the extent of each term,
+// then emits the terms in order.
+class compiler_t {
+public:
+    compiler_t(const adobe::array_t&       tokens,
+               std::vector<instruction_t>& code,
+               adobe::array_t&             constants,
+               std::vector<adobe::name_t>& names)
+        : tokens_m(tokens), code_m(code), constants_m(constants), names_m(names) {}
+
+    void compile() {
+        if (tokens_m.empty() || emit(tokens_m.size() - 1) != 0)
+            throw unsupported_t();
+    }
+
+private:
+    const operator_t* operator_at(std::size_t index) const {
+        const adobe::any_regular_t& token(tokens_m[index]);
+
+        if (token.type_info() != typeid(adobe::name_t))
+            return 0;
+
+        adobe::name_t                  name(token.cast<adobe::name_t>());
+        operator_map_t::const_iterator found(operator_map().find(name));
+
+        if (found != operator_map().end())
+            return &found->second;
+
+        // .dictionary, for one, along with anything else the virtual machine knows and we do not.
+        if (name == adobe::dictionary_k || (name && name.c_str()[0] == '.'))
+            throw unsupported_t();
+
+        return 0;
+    }
+
+    std::size_t previous(std::size_t first) const {
+        if (first == 0)
+            throw unsupported_t();
+
+        return first - 1;
+    }
+
+    std::size_t operand_count(std::size_t last) const {
+        const operator_t* op(operator_at(last));
+
+        if (!op)
+            return 0;
+
+        if (op->opcode_m != op_array_k)
+            return op->arity_m;
+
+        // the array's values are followed by their count
+        const adobe::any_regular_t& count(tokens_m[previous(last)]);
+
+        if (count.type_info() != typeid(double))
+            throw unsupported_t();
+
+        return static_cast<std::size_t>(count.cast<double>()) + 1;
+    }
+
+    std::size_t first_of(std::size_t last) const {
+        std::size_t first(last);
+
+        for (std::size_t n(operand_count(last)); n != 0; --n)
+            first = first_of(previous(first));
+
+        return first;
+    }
+
+    bool is_name(std::size_t last) const {
+        return !operator_at(last) && tokens_m[last].type_info() == typeid(adobe::name_t);
+    }
+
+    adobe::name_t name_at(std::size_t last) const {
+        if (!is_name(last))
+            throw unsupported_t();
+
+        return tokens_m[last].cast<adobe::name_t>();
+    }
+
+    boost::uint32_t intern(adobe::name_t name) {
+        names_m.push_back(name);
+
+        return static_cast<boost::uint32_t>(names_m.size() - 1);
+    }
+
+    std::size_t push(opcode_t opcode, std::size_t operand = 0, std::size_t count = 0) {
+        code_m.push_back(instruction_t{opcode,
+                                       static_cast<boost::uint32_t>(operand),
+                                       static_cast<boost::uint32_t>(count)});
+
+        return code_m.size() - 1;
+    }
+
+    void patch(std::size_t jump) {
+        code_m[jump].operand_m = static_cast<boost::uint32_t>(code_m.size());
+    }
+
+    // compiles an operand of .and, .or or .ifelse, which is an expression in its own right.
+    void nested(std::size_t last) {
+        const adobe::any_regular_t& token(tokens_m[last]);
+
+        if (operator_at(last) || token.type_info() != typeid(adobe::array_t))
+            throw unsupported_t();
+
+        compiler_t(token.cast<adobe::array_t>(), code_m, constants_m, names_m).compile();
+    }
+
+    // emits a function's argument list, returning the number of arguments.
+    std::size_t arguments(std::size_t last) {
+        const operator_t* op(operator_at(last));
+
+        if (!op) {
+            // no arguments
+            const adobe::any_regular_t& token(tokens_m[last]);
+
+            if (token.type_info() != typeid(adobe::array_t) ||
+                !token.cast<adobe::array_t>().empty())
+                throw unsupported_t();
+
+            return 0;
+        }
+
+        if (op->opcode_m != op_array_k)
+            throw unsupported_t();
+
+        std::size_t count(operand_count(last) - 1);
+
+        emit_operands(last, count);
+
+        return count;
+    }
+
+    // emits the first count operands of the term ending at last, returning where the term starts.
+    std::size_t emit_operands(std::size_t last, std::size_t count) {
+        std::vector<std::size_t> ends(operand_count(last));
+        std::size_t              first(last);
+
+        for (std::size_t i(ends.size()); i != 0; --i) {
+            ends[i - 1] = previous(first);
+            first       = first_of(ends[i - 1]);
+        }
+
+        for (std::size_t i(0); i != count; ++i)
+            emit(ends[i]);
+
+        return first;
+    }
+
+    // emits the term ending at last, returning where it starts.
+    std::size_t emit(std::size_t last) {
+        const operator_t* op(operator_at(last));
+
+        if (!op) {
+            constants_m.push_back(tokens_m[last]);
+
+            push(op_push_k, constants_m.size() - 1);
+
+            return last;
+        }
+
+        std::size_t operand(previous(last));
+        std::size_t first(0);
+
+        switch (op->opcode_m) {
+            case op_variable_k: {
+                adobe::name_t name(name_at(operand));
+
+                first = operand;
+
+                if (name == value_main)
+                    push(op_main_k);
+                else if (name == value_this)
+                    push(op_this_k);
+                else
+                    push(op_variable_k, intern(name));
+            } break;
+            case op_index_k: {
+                if (is_name(operand)) {
+                    // the common case, field.subfield
+                    first = emit(previous(operand));
+
+                    push(op_subfield_k, intern(name_at(operand)));
+                } else {
+                    first = emit_operands(last, 2);
+
+                    push(op_index_k);
+                }
+            } break;
+            case op_call_k: {
+                builtin_function_t function(builtin_function_for(name_at(operand)));
+
+                // e.g., one of the virtual machine's own
+                if (function == builtin_unknown_k)
+                    throw unsupported_t();
+
+                first = first_of(previous(operand));
+
+                push(op_call_k, function, arguments(previous(operand)));
+            } break;
+            case op_array_k: {
+                std::size_t count(operand_count(last) - 1);
+
+                first = emit_operands(last, count);
+
+                push(op_array_k, 0, count);
+            } break;
+            case op_and_k:
+            case op_or_k: {
+                first = emit_operands(last, 1);
+
+                std::size_t jump(push(op->opcode_m));
+
+                nested(operand);
+                patch(jump);
+            } break;
+            case op_jump_unless_k: {
+                // .ifelse
+                std::size_t else_end(operand);
+                std::size_t then_end(previous(first_of(else_end)));
+
+                first = emit_operands(last, 1);
+
+                std::size_t jump_to_else(push(op_jump_unless_k));
+
+                nested(then_end);
+
+                std::size_t jump_to_end(push(op_jump_k));
+
+                patch(jump_to_else);
+                nested(else_end);
+                patch(jump_to_end);
+            } break;
+            default: {
+                first = emit_operands(last, op->arity_m);
+
+                push(op->opcode_m);
+            } break;
+        }
+
+        return first;
+    }
+
+    const adobe::array_t&       tokens_m;
+    std::vector<instruction_t>& code_m;
+    adobe::array_t&             constants_m;
+    std::vector<adobe::name_t>& names_m;
+};
+
+/****************************************************************************************************/
+
+// Folds code made only of numeric literals and arithmetic on them, the same way the engine would
+// evaluate it. Returns false, leaving result alone, for anything else.
+bool fold_constant(const std::vector<instruction_t>& code,
+                   const adobe::array_t&             constants,
+                   adobe::any_regular_t&             result) try {
+    std::vector<adobe::any_regular_t> stack;
+
+    for (const auto& instruction : code) {
+        switch (instruction.opcode_m) {
+            case op_push_k:
+                stack.push_back(constants[instruction.operand_m]);
+                break;
+            case op_negate_k:
+                stack.back() = adobe::any_regular_t(-stack.back().cast<double>());
+                break;
+            case op_add_k:
+            case op_subtract_k:
+            case op_multiply_k:
+            case op_divide_k: {
+                double rhs(stack.back().cast<double>());
+
+                stack.pop_back();
+
+                double lhs(stack.back().cast<double>());
+
+                if (instruction.opcode_m == op_add_k)
+                    lhs += rhs;
+                else if (instruction.opcode_m == op_subtract_k)
+                    lhs -= rhs;
+                else if (instruction.opcode_m == op_multiply_k)
+                    lhs *= rhs;
+                else
+                    lhs /= rhs;
+
+                stack.back() = adobe::any_regular_t(lhs);
+            } break;
+            default:
+                return false;
+        }
+    }
+
+    if (stack.size() != 1)
+        return false;
+
+    result = stack.back();
+
+    return true;
+} catch (const std::exception&) {
+    // e.g., a bad cast, which is for evaluation to report.
+    return false;
+}
+
+/****************************************************************************************************/
+
+} // namespace
+
+/****************************************************************************************************/
+
+builtin_function_t builtin_function_for(adobe::name_t name) {
+    typedef adobe::closed_hash_map<adobe::name_t, builtin_function_t> builtin_map_t;
+
+    static const builtin_map_t map_s([]() {
+        CONSTANT_VALUE(byte);
+        CONSTANT_VALUE(card);
+        CONSTANT_VALUE(endof);
+        CONSTANT_VALUE(fcc);
+        CONSTANT_VALUE(gtell);
+        CONSTANT_VALUE(indexof);
+        CONSTANT_VALUE(itoah); // integer to hex string (c++'s itoa, hex format)
+        CONSTANT_VALUE(itop);
+        CONSTANT_VALUE(padd);
+        CONSTANT_VALUE(path);
+        CONSTANT_VALUE(peek);
+        CONSTANT_VALUE(print);
+        CONSTANT_VALUE(psub);
+        CONSTANT_VALUE(ptoi);
+        CONSTANT_VALUE(sizeof);
+        CONSTANT_VALUE(startof);
+        CONSTANT_VALUE(str);
+        CONSTANT_VALUE(strcat);
+        CONSTANT_VALUE(summaryof);
+        CONSTANT_VALUE(utf16utf8);
+
+        builtin_map_t result;
+
+        result[value_byte]      = builtin_byte_k;
+        result[value_card]      = builtin_card_k;
+        result[value_endof]     = builtin_endof_k;
+        result[value_fcc]       = builtin_fcc_k;
+        result[value_gtell]     = builtin_gtell_k;
+        result[value_indexof]   = builtin_indexof_k;
+        result[value_itoah]     = builtin_itoah_k;
+        result[value_itop]      = builtin_itop_k;
+        result[value_padd]      = builtin_padd_k;
+        result[value_path]      = builtin_path_k;
+        result[value_peek]      = builtin_peek_k;
+        result[value_print]     = builtin_print_k;
+        result[value_psub]      = builtin_psub_k;
+        result[value_ptoi]      = builtin_ptoi_k;
+        result[value_sizeof]    = builtin_sizeof_k;
+        result[value_startof]   = builtin_startof_k;
+        result[value_str]       = builtin_str_k;
+        result[value_strcat]    = builtin_strcat_k;
+        result[value_summaryof] = builtin_summaryof_k;
+        result[value_utf16utf8] = builtin_utf16utf8_k;
+
+        return result;
+    }());
+
+    builtin_map_t::const_iterator found(map_s.find(name));
+
+    return found == map_s.end() ? builtin_unknown_k : found->second;
+}
+
+/****************************************************************************************************/
+
+compiled_expression_t::compiled_expression_t(const adobe::array_t& expression)
+    : source_m(&expression), fallback_m(false), constant_m(false) {
+    try {
+        compiler_t(expression, code_m, constants_m, names_m).compile();
+    } catch (const unsupported_t&) {
+        fallback_m = true;
+
+        code_m.clear();
+        constants_m.clear();
+        names_m.clear();
+
+        return;
+    }
+
+    constant_m = fold_constant(code_m, constants_m, constant_value_m);
+}
+
+/****************************************************************************************************/
@@ -131,41 +131,24 @@ std::uint64_t synthesize(const rawbytes_t& raw,
                          boost::uint64_t   bit_count,
                          atom_base_type_t  base_type,
                          bool              is_big_endian) {
-    rawbytes_t byte_set(raw);
+    if (bit_count > 64 || raw.size() > sizeof(std::uint64_t))
+        throw std::runtime_error("synthesize: invalid bit count");
 
-    host_to_endian(byte_set, is_big_endian);
+    std::uint64_t x(uint_from_bytes(raw.data(), raw.size(), is_big_endian));
 
-    auto p(&byte_set[0]);
+    if (base_type != atom_signed_k)
+        return x;
 
-    if (bit_count <= 8) {
-        if (base_type == atom_signed_k)
-            return *reinterpret_cast<const boost::int8_t*>(p);
-
-        return *reinterpret_cast<const boost::uint8_t*>(p);
-    }
+    if (bit_count <= 8)
+        return static_cast<boost::int8_t>(x);
 
-    if (bit_count <= 16) {
-        if (base_type == atom_signed_k)
-            return *reinterpret_cast<const boost::int16_t*>(p);
+    if (bit_count <= 16)
+        return static_cast<boost::int16_t>(x);
 
-        return *reinterpret_cast<const boost::uint16_t*>(p);
-    }
-
-    if (bit_count <= 32) {
-        if (base_type == atom_signed_k)
-            return *reinterpret_cast<const boost::int32_t*>(p);
-
-        return *reinterpret_cast<const boost::uint32_t*>(p);
-    }
-
-    if (bit_count <= 64) {
-        if (base_type == atom_signed_k)
-            return *reinterpret_cast<const boost::int64_t*>(p);
-
-        return *reinterpret_cast<const boost::uint64_t*>(p);
-    }
+    if (bit_count <= 32)
+        return static_cast<boost::int32_t>(x);
 
-    throw std::runtime_error("synthesize: invalid bit count");
+    return static_cast<boost::int64_t>(x);
 }
 
 /****************************************************************************************************/
@@ -283,11 +283,10 @@ std::size_t fuzzer_t::attack_chunk_array_with(const node_set_t& node_set) {
     if (count == 0 || count == 1)
         return 0;
 
-    std::vector<rawbytes_t>     element_byte_set;
-    boost::filesystem::ifstream bfinput(input_path_m, std::ios::binary);
-    bitreader_t                 input(bfinput);
-    inspection_position_t       startpos(invalid_position_k);
-    inspection_position_t       endpos(invalid_position_k);
+    std::vector<rawbytes_t> element_byte_set;
+    bitreader_t             input(input_path_m);
+    inspection_position_t   startpos(invalid_position_k);
+    inspection_position_t   endpos(invalid_position_k);
 
     // First we get the raw bytes of each element in the array, which we'll later
     // shuffle around and write out in their shuffled sequence starting at the
@@ -385,6 +384,15 @@ std::size_t fuzzer_t::attack_chunk_array(const attack_vector_t& entry) {
     // at every position within the document. This will give us N - 1
     // files upon output and is a good start for an attack of this type.
 
+    // Atom array elements only have nodes when they have been used; they never
+    // carried start and end offsets of their own to shuffle in any case.
+    if (entry.node_m.get_flag(is_implicit_array_k)) {
+        if (size > 1)
+            output_m << "    ! invalid child node position(s)\n";
+
+        return 0;
+    }
+
     typedef std::vector<const_inspection_branch_t> child_node_set_t;
     //typedef child_node_set_t::iterator             iterator;
 
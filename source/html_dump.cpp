@@ -10,6 +10,7 @@
 
 // stdc++
 #include <fstream>
+#include <iterator>
 
 // application
 #include <binspector/bitreader.hpp>
@@ -53,11 +54,12 @@ void detail_struct_or_array_node(bitreader_t& /*input*/,
     if (is_array_root)
         output << "elements: " << node_property(struct_node, ARRAY_ROOT_PROPERTY_SIZE) << "<br/>";
 
-    inspection_forest_t::child_iterator first_child(adobe::child_begin(struct_node));
-    inspection_forest_t::child_iterator last_child(adobe::child_end(struct_node));
-
-    if (first_child == last_child)
+    if (struct_node->get_flag(is_implicit_array_k)) {
+        if (struct_node->cardinal_m == 0)
+            return;
+    } else if (!adobe::has_children(struct_node)) {
         return;
+    }
 
     inspection_position_t start_byte_offset(starting_offset_for(struct_node));
     inspection_position_t end_byte_offset(ending_offset_for(struct_node));
@@ -89,7 +91,7 @@ void detail_atom_node(bitreader_t&         input,
     bool                  is_big_endian(node_property(atom_node, ATOM_PROPERTY_IS_BIG_ENDIAN));
     boost::uint64_t       bit_count(node_property(atom_node, ATOM_PROPERTY_BIT_COUNT));
     inspection_position_t position(node_value(atom_node, ATOM_VALUE_LOCATION));
-    rawbytes_t            raw(input.read_bits(position, bit_count));
+    rawview_t             raw(input.read_bits_view(position, bit_count));
     adobe::any_regular_t  value(evaluate(raw, bit_count, base_type, is_big_endian));
 
     output << "path: " << build_path(forest.begin(), atom_node) << "<br/>"
@@ -163,12 +165,11 @@ void detail_node(bitreader_t&         input,
 
 /****************************************************************************************************/
 
-void print_node(bitreader_t&          input,
-                std::ostream&         output,
-                inspection_forest_t&  forest,
-                depth_full_iterator_t iterator) {
-    inspection_branch_t       branch(iterator.base());
-    std::size_t               depth(iterator.depth());
+void print_node(bitreader_t&         input,
+                std::ostream&        output,
+                inspection_forest_t& forest,
+                inspection_branch_t  branch,
+                std::size_t          depth) {
     const_inspection_branch_t pbranch(property_node_for(branch));
     bool                      is_atom(pbranch->get_flag(type_atom_k));
     bool                      is_const(pbranch->get_flag(type_const_k));
@@ -233,8 +234,10 @@ void print_node(bitreader_t&          input,
             output << name;
         }
 
-        if (!branch->summary_m.empty()) {
-            output << " (" << branch->summary_m << ")";
+        const std::string& summary(summary_of(forest.begin(), branch, input));
+
+        if (!summary.empty()) {
+            output << " (" << summary << ")";
         }
 
         output << "</span><span class='tip'>";
@@ -261,11 +264,7 @@ void print_node(bitreader_t&          input,
                     else
                         output << value;
                 } else {
-                    const adobe::array_t& const_expression(
-                        node_value(branch, CONST_VALUE_EXPRESSION));
-
-                    output << contextual_evaluation_of<adobe::any_regular_t>(
-                        const_expression, forest.begin(), adobe::find_parent(branch), input);
+                    output << declared_value_of(forest.begin(), branch, input);
                 }
             }
         } else if (is_atom && !is_array_root) {
@@ -309,15 +308,15 @@ void print_node(bitreader_t&          input,
 #endif
 /****************************************************************************************************/
 
-void binspector_html_dump(std::istream&      input,
-                          auto_forest_t      aforest,
-                          std::ostream&      output,
-                          const std::string& coutput,
-                          const std::string& cerrput) {
+void binspector_html_dump(const boost::filesystem::path& input_path,
+                          auto_forest_t                  aforest,
+                          std::ostream&                  output,
+                          const std::string&             coutput,
+                          const std::string&             cerrput) {
     inspection_forest_t& forest(*aforest);
     inspection_branch_t  begin(adobe::leading_of(forest.begin()));
     inspection_branch_t  end(adobe::trailing_of(forest.begin()));
-    bitreader_t          bitreader(input);
+    bitreader_t          bitreader(input_path);
 
     output
         << "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.01 Transitional//EN\" \"http://www.w3.org/TR/html4/loose.dtd\">\n"
@@ -454,8 +453,31 @@ void binspector_html_dump(std::istream&      input,
         << "<h2>Tree</h2>\n"
         << "<ul class='beta'>\n";
 
-    for (depth_full_iterator_t iter(begin), last(++end); iter != last; ++iter)
-        print_node(bitreader, output, forest, iter);
+    for (depth_full_iterator_t iter(begin), last(++end); iter != last; ++iter) {
+        print_node(bitreader, output, forest, iter.base(), iter.depth());
+
+        if (iter.edge() != adobe::forest_leading_edge ||
+            !iter.base()->get_flag(is_implicit_array_k))
+            continue;
+
+        // Print every element of an implicit array, then skip past the ones that have been
+        // materialized so they are not printed twice.
+        inspection_branch_t root(iter.base());
+        std::size_t         depth(iter.depth() + 1);
+
+        for_each_array_element(root, [&](inspection_branch_t element) {
+            print_node(bitreader, output, forest, element, depth);
+
+            element.edge() = adobe::forest_trailing_edge;
+
+            print_node(bitreader, output, forest, element, depth);
+        });
+
+        inspection_branch_t trailing(adobe::trailing_of(root));
+
+        while (std::next(iter).base() != trailing)
+            ++iter;
+    }
 
     output << "</ul>\n";
     output << "</body>\n";
@@ -10,6 +10,7 @@
 
 // stdc++
 #include <fstream>
+#include <iterator>
 
 // asl
 #include <adobe/istream.hpp>
@@ -53,10 +54,11 @@ void stream_out(const adobe::any_regular_t& value,
 #endif
 /****************************************************************************************************/
 
-binspector_interface_t::binspector_interface_t(std::istream& binary_file,
-                                               auto_forest_t forest,
-                                               std::ostream& output)
-    : input_m(binary_file), forest_m(std::move(forest)), output_m(output), node_m(forest_m->begin()) {
+binspector_interface_t::binspector_interface_t(const boost::filesystem::path& binary_path,
+                                               auto_forest_t                  forest,
+                                               std::ostream&                  output)
+    : input_m(binary_path), forest_m(std::move(forest)), output_m(output),
+      node_m(forest_m->begin()) {
     command_map_m["q"] = &binspector_interface_t::quit;
     command_map_m["quit"] = &binspector_interface_t::quit;
     command_map_m["?"] = &binspector_interface_t::help;
@@ -207,6 +209,8 @@ bool binspector_interface_t::help(const command_segment_set_t&) {
 /****************************************************************************************************/
 
 bool binspector_interface_t::print_branch(const command_segment_set_t&) {
+    expand_subtree(node_m);
+
     inspection_branch_t begin(adobe::leading_of(node_m));
     inspection_branch_t end(adobe::trailing_of(node_m));
 
@@ -219,13 +223,21 @@ bool binspector_interface_t::print_branch(const command_segment_set_t&) {
 /****************************************************************************************************/
 
 bool binspector_interface_t::print_structure(const command_segment_set_t&) {
+    expand_node(node_m);
+
     print_node(adobe::leading_of(node_m), true, 0);
 
-    inspection_forest_t::child_iterator iter(adobe::child_begin(node_m));
-    inspection_forest_t::child_iterator last(adobe::child_end(node_m));
+    if (node_m->get_flag(is_implicit_array_k)) {
+        for_each_array_element(node_m, [&](inspection_branch_t element) {
+            print_node(element, false, 1);
+        });
+    } else {
+        inspection_forest_t::child_iterator iter(adobe::child_begin(node_m));
+        inspection_forest_t::child_iterator last(adobe::child_end(node_m));
 
-    for (; iter != last; ++iter)
-        print_node(iter.base(), false, 1);
+        for (; iter != last; ++iter)
+            print_node(iter.base(), false, 1);
+    }
 
     print_node(adobe::trailing_of(node_m), true, 0);
 
@@ -266,9 +278,7 @@ bool binspector_interface_t::print_string(const command_segment_set_t& parameter
         inspection_position_t size(end_byte_offset - start_byte_offset + inspection_byte_k);
         std::size_t           bytes(static_cast<std::size_t>(size.bytes()));
 
-        input_m.seek(start_byte_offset);
-
-        rawbytes_t str(input_m.read(bytes));
+        rawview_t str(input_m.read_view(start_byte_offset, bytes));
 
         for (std::size_t i(0); i < bytes; ++i) {
             unsigned char c(str[i]);
@@ -335,7 +345,7 @@ bool binspector_interface_t::step_out(const command_segment_set_t& parameters) {
     node_m.edge() = adobe::forest_leading_edge;
 
     if (node_m != forest_m->begin())
-        node_m = adobe::find_parent(node_m);
+        node_m = parent_of(node_m);
 
     return true;
 }
@@ -395,6 +405,23 @@ bool binspector_interface_t::detail_offset(const command_segment_set_t& paramete
     }
 
     while (true) {
+        if (current->get_flag(is_implicit_array_k)) {
+            // the elements of an atom array are evenly spaced; go straight to the right one.
+            inspection_position_t first(node_value(current, ATOM_VALUE_LOCATION));
+            boost::uint64_t       bit_count(current->bit_count_m);
+            boost::uint64_t       first_bit(first.bytes() * 8 + first.bits());
+
+            if (current->cardinal_m != 0 && bit_count != 0)
+                current = array_element(current,
+                                        std::min(current->cardinal_m - 1,
+                                                 (std::max(offset * 8, first_bit) - first_bit) /
+                                                     bit_count));
+
+            break;
+        }
+
+        expand_node(current);
+
         inspection_forest_t::child_iterator iter(adobe::child_begin(current));
         inspection_forest_t::child_iterator last(adobe::child_end(current));
 
@@ -554,6 +581,8 @@ bool binspector_interface_t::save_field(const command_segment_set_t& parameters)
 /****************************************************************************************************/
 
 bool binspector_interface_t::usage_metrics(const command_segment_set_t& /*parameters*/) {
+    expand_subtree(forest_m->begin());
+
     attack_vector_set_t usage_set(build_attack_vector_set(*forest_m));
 
     output_m << "Found " << usage_set.size() << " weak points:\n";
@@ -581,6 +610,8 @@ bool binspector_interface_t::find_field(const command_segment_set_t& parameters)
 
     adobe::name_t field_name(parameters[1].c_str());
 
+    expand_subtree(node_m);
+
     inspection_branch_t begin(adobe::leading_of(node_m));
     inspection_branch_t end(adobe::trailing_of(node_m));
 
@@ -617,19 +648,20 @@ void binspector_interface_t::save_range(boost::uint64_t    first,
 
     input_m.seek(bytepos(first));
 
-    static const std::size_t block_size_k(1024); // 1K chunks; easy enough to adjust
+    // Blocks keep the stream fallback from buffering the whole range; a mapped
+    // input hands back views into the file and never copies.
+    static const std::size_t block_size_k(64 * 1024); // easy enough to adjust
     boost::uint64_t          range_size(last - first);
-    boost::uint64_t          block_count(range_size / block_size_k);
-    boost::uint64_t          leftovers(range_size - (block_count * block_size_k));
 
-    rawbytes_t block_buffer(input_m.read(leftovers));
+    while (range_size != 0) {
+        std::size_t block_size(static_cast<std::size_t>(
+            std::min<boost::uint64_t>(range_size, block_size_k)));
+        rawview_t   block(input_m.read_view(block_size));
 
-    output.write(reinterpret_cast<char*>(&block_buffer[0]),
-                 static_cast<std::streamsize>(leftovers));
+        output.write(reinterpret_cast<const char*>(block.begin()),
+                     static_cast<std::streamsize>(block_size));
 
-    for (std::size_t i(0); i < block_count; ++i) {
-        block_buffer = input_m.read(block_size_k);
-        output.write(reinterpret_cast<char*>(&block_buffer[0]), block_size_k);
+        range_size -= block_size;
     }
 }
 
@@ -644,18 +676,18 @@ void binspector_interface_t::dump_range(boost::uint64_t first, boost::uint64_t l
     boost::uint64_t            n(0);
     std::vector<unsigned char> char_dump;
 
-    input_m.seek(bytepos(first));
+    rawview_t range;
 
-    while (n != size) {
-        rawbytes_t buffer(input_m.read(1));
-
-        if (input_m.fail()) {
-            input_m.clear();
-            std::cerr << "Input stream failure reading byte " << n << '\n';
-            return;
-        }
+    try {
+        range = input_m.read_view(bytepos(first), size);
+    } catch (const std::exception& error) {
+        input_m.clear();
+        std::cerr << "Input stream failure reading range: " << error.what() << '\n';
+        return;
+    }
 
-        unsigned char c(buffer[0]);
+    while (n != size) {
+        unsigned char c(range[n]);
 
         output_m.width(2);
         output_m.fill('0');
@@ -750,6 +782,8 @@ void binspector_interface_t::line_completion(const char *buf, linenoiseCompletio
     std::string before{s_buf.substr(0, spacepos)};
     std::string after{s_buf.substr(spacepos + 1)};
 
+    expand_node(node_m);
+
     for (const auto& child : adobe::child_range(node_m)) {
         std::string name{child.name_m.c_str()};
         if (name.find(after) == std::string::size_type(0)) {
@@ -849,8 +883,27 @@ template <typename R>
 void binspector_interface_t::print_branch_depth_range(const R& f) {
     typedef typename boost::range_iterator<R>::type iterator;
 
-    for (iterator iter(boost::begin(f)), last(boost::end(f)); iter != last; ++iter)
+    for (iterator iter(boost::begin(f)), last(boost::end(f)); iter != last; ++iter) {
         print_node(iter, true);
+
+        if (iter.edge() != adobe::forest_leading_edge ||
+            !iter.base()->get_flag(is_implicit_array_k))
+            continue;
+
+        // Print every element of an implicit array, then skip past the ones that have been
+        // materialized so they are not printed twice.
+        inspection_branch_t root(iter.base());
+        std::size_t         depth(iter.depth() + 1);
+
+        for_each_array_element(root, [&](inspection_branch_t element) {
+            print_node(element, true, depth);
+        });
+
+        inspection_branch_t trailing(adobe::trailing_of(root));
+
+        while (std::next(iter).base() != trailing)
+            ++iter;
+    }
 }
 
 /****************************************************************************************************/
@@ -915,8 +968,10 @@ void binspector_interface_t::print_node(inspection_branch_t branch,
             output_m << name;
         }
 
-        if (!branch->summary_m.empty()) {
-            output_m << " (" << branch->summary_m << ')';
+        const std::string& summary(summary_of(forest_m->begin(), branch, input_m));
+
+        if (!summary.empty()) {
+            output_m << " (" << summary << ')';
         }
 
         if (is_const) {
@@ -933,10 +988,7 @@ void binspector_interface_t::print_node(inspection_branch_t branch,
                 else
                     output_m << value;
             } else {
-                const adobe::array_t& const_expression(node_value(branch, CONST_VALUE_EXPRESSION));
-
-                output_m << contextual_evaluation_of<adobe::any_regular_t>(
-                    const_expression, forest_m->begin(), adobe::find_parent(branch), input_m);
+                output_m << declared_value_of(forest_m->begin(), branch, input_m);
             }
         }
 
@@ -993,11 +1045,12 @@ void binspector_interface_t::detail_struct_or_array_node(inspection_branch_t str
     if (is_array_root)
         output_m << " elements: " << node_property(struct_node, ARRAY_ROOT_PROPERTY_SIZE) << '\n';
 
-    inspection_forest_t::child_iterator first_child(adobe::child_begin(struct_node));
-    inspection_forest_t::child_iterator last_child(adobe::child_end(struct_node));
-
-    if (first_child == last_child)
+    if (struct_node->get_flag(is_implicit_array_k)) {
+        if (struct_node->cardinal_m == 0)
+            return;
+    } else if (!adobe::has_children(struct_node)) {
         return;
+    }
 
     inspection_position_t start_byte_offset(starting_offset_for(struct_node));
     inspection_position_t end_byte_offset(ending_offset_for(struct_node));
@@ -1026,7 +1079,7 @@ void binspector_interface_t::detail_atom_node(inspection_branch_t atom_node) {
     bool                  is_big_endian(node_property(atom_node, ATOM_PROPERTY_IS_BIG_ENDIAN));
     boost::uint64_t       bit_count(node_property(atom_node, ATOM_PROPERTY_BIT_COUNT));
     inspection_position_t position(node_value(atom_node, ATOM_VALUE_LOCATION));
-    rawbytes_t            raw(input_m.read_bits(position, bit_count));
+    rawview_t             raw(input_m.read_bits_view(position, bit_count));
     adobe::any_regular_t  value(evaluate(raw, bit_count, base_type, is_big_endian));
 
     output_m << "     path: " << build_path(forest_m->begin(), atom_node) << '\n'
@@ -36,6 +36,35 @@
 
 typedef std::vector<boost::filesystem::path> path_set;
 
+/****************************************************************************************************/
+// The runs of bytes that differ between two files, including whatever one has past the end of the
+// other.
+binspector_analyzer_t::byte_range_set_t modified_ranges(const boost::filesystem::path& original,
+                                                        const boost::filesystem::path& edited) {
+    boost::filesystem::ifstream             original_file(original, std::ios_base::binary);
+    boost::filesystem::ifstream             edited_file(edited, std::ios_base::binary);
+    binspector_analyzer_t::byte_range_set_t result;
+
+    for (boost::uint64_t offset(0);; ++offset) {
+        int original_byte(original_file.get());
+        int edited_byte(edited_file.get());
+
+        if (original_byte == std::char_traits<char>::eof() &&
+            edited_byte == std::char_traits<char>::eof())
+            break;
+
+        if (original_byte == edited_byte)
+            continue;
+
+        if (!result.empty() && result.back().second == offset)
+            ++result.back().second;
+        else
+            result.push_back(std::make_pair(offset, offset + 1));
+    }
+
+    return result;
+}
+
 /****************************************************************************************************/
 
 int main(int argc, char** argv) try {
@@ -46,10 +75,16 @@ int main(int argc, char** argv) try {
     std::string                                 output_mode;
     std::string                                 starting_struct;
     std::string                                 dump_path;
+    std::string                                 edited_path_string;
     path_set                                    include_path_set;
     bool                                        quiet(false);
     bool                                        path_hash(false);
     bool                                        fuzz_recurse(false);
+    bool                                        cache_stats(false);
+    bool                                        node_stats(false);
+    bool                                        parallel(false);
+    bool                                        interpret(false);
+    std::size_t                                 cache_block_size(default_cache_block_size_k);
 
     cli_parameters.add_options()("help,?", "Print this help message then exits")(
         "template,t",
@@ -87,7 +122,26 @@ int main(int argc, char** argv) try {
         "Recursive fuzz mode. Generates about 1000 files. Each time a file is generated, there's a good chance it will be used as the basis for another fuzz. Implies --path_hash")(
         "starting-struct,s",
         boost::program_options::value<std::string>(&starting_struct)->default_value("main"),
-        "Specify struct to use as root for analysis and -m dot");
+        "Specify struct to use as root for analysis and -m dot")(
+        "cache-block-size",
+        boost::program_options::value<std::size_t>(&cache_block_size)
+            ->default_value(default_cache_block_size_k),
+        "Size in bytes of the blocks cached when the binary file is read as a stream instead of memory mapped")(
+        "cache-stats",
+        boost::program_options::bool_switch(&cache_stats),
+        "Print read cache hits and misses for the analysis (to stderr)")(
+        "node-stats",
+        boost::program_options::bool_switch(&node_stats),
+        "Print the most nodes the analysis held at once (to stderr)")(
+        "parallel",
+        boost::program_options::bool_switch(&parallel),
+        "Analyze the bodies of length-prefixed array elements on multiple threads")(
+        "interpret",
+        boost::program_options::bool_switch(&interpret),
+        "Evaluate template expressions with the ASL virtual machine instead of compiling them (to compare their speed)")(
+        "reanalyze",
+        boost::program_options::value<std::string>(&edited_path_string),
+        "Analyze the binary file, then this edit of it from where the edit could first make a difference. The output is for the edit");
 
     boost::program_options::variables_map var_map;
     boost::program_options::store(
@@ -128,6 +182,7 @@ int main(int argc, char** argv) try {
     boost::filesystem::path template_path{template_path_string};
     boost::filesystem::path binary_path{binary_path_string};
     boost::filesystem::path output_path{output_path_string};
+    boost::filesystem::path edited_path{edited_path_string};
     boost::filesystem::ifstream template_description(template_path);
 
     // Open the template file, if we can.
@@ -159,11 +214,14 @@ int main(int argc, char** argv) try {
         throw std::runtime_error(error);
     }
 
-    boost::filesystem::ifstream binary(binary_path, std::ios_base::binary);
-
-    if (!binary && output_mode != "dot")
+    // The binary is read (memory mapped where possible) by the analyzer and the output modes
+    // themselves; here we only make sure it can be opened.
+    if (output_mode != "dot" && !boost::filesystem::ifstream(binary_path, std::ios_base::binary))
         throw std::runtime_error("Could not open binary input file");
 
+    if (!edited_path.empty() && !boost::filesystem::ifstream(edited_path, std::ios_base::binary))
+        throw std::runtime_error("Could not open edited binary file");
+
     // Set up output and error streams
     std::ostringstream outstream;
     std::ostringstream errstream;
@@ -180,10 +238,36 @@ int main(int argc, char** argv) try {
     // kick up the analyzer in preparation for template parsing
     // REVISIT (fbrereto) : consider moving the pass of the binary
     //                      stream to analyze_binary
-    binspector_analyzer_t analyzer(binary, sout, serr);
+    // A reanalysis takes back the messages written after where it starts, so until it is done they
+    // go to streams that can seek, one for each of sout and serr; see set_incremental.
+    bool                  reanalyzing(!edited_path.empty());
+    std::ostringstream    rewindable_out;
+    std::ostringstream    rewindable_err;
+    std::ostream& analysis_out(reanalyzing ? rewindable_out : static_cast<std::ostream&>(sout));
+    std::ostream& analysis_err(reanalyzing ? rewindable_err : static_cast<std::ostream&>(serr));
+    binspector_analyzer_t analyzer(binary_path, analysis_out, analysis_err);
 
     analyzer.set_quiet(quiet || output_mode == "fuzz");
 
+    set_interpret_expressions(interpret);
+
+    analyzer.set_parallel(parallel);
+
+    // validation shows nothing of the forest but what its expressions turn up
+    analyzer.set_skeleton(output_mode == "validate");
+
+    // nor does it keep what it has finished with
+    analyzer.set_streaming(output_mode == "validate");
+
+    // the prompt comes up before the bodies of sentries are analyzed; see expand_node
+    analyzer.set_lazy(output_mode == "cli");
+
+    analyzer.set_incremental(reanalyzing);
+
+    analyzer.set_node_stats(node_stats);
+
+    analyzer.input().set_cache(cache_block_size, default_cache_block_count_k);
+
     try {
         adobe::line_position_t::getline_proc_t getline(
             new adobe::line_position_t::getline_proc_impl_t(
@@ -210,6 +294,29 @@ int main(int argc, char** argv) try {
     // Do the actual analysis, set the return result so we can track errors therein
     int result(analyzer.analyze_binary(starting_struct) == false);
 
+    if (reanalyzing) {
+        result = analyzer.reanalyze(
+                     analyzer.forest(), edited_path, modified_ranges(binary_path, edited_path)) ==
+                 false;
+
+        binary_path = edited_path;
+
+        // what the streams hold past where the reanalysis left them is the original's
+        sout << rewindable_out.str().substr(0, static_cast<std::size_t>(rewindable_out.tellp()));
+        serr << rewindable_err.str().substr(0, static_cast<std::size_t>(rewindable_err.tellp()));
+    }
+
+    if (cache_stats) {
+        const bitreader_t& input(analyzer.input());
+
+        std::cerr << "Read cache: " << input.cache_hits() << " hits, " << input.cache_misses()
+                  << " misses" << (input.mapped() ? " (binary file is memory mapped)" : "")
+                  << '\n';
+    }
+
+    if (node_stats)
+        std::cerr << "Forest: at most " << analyzer.peak_node_count() << " nodes at once\n";
+
     // clean up our output and error tee buffers
     sout.flush();
     sout.close();
@@ -222,11 +329,11 @@ int main(int argc, char** argv) try {
     if (output_mode == "cli") {
         std::cout << combostream.str();
 
-        binspector_interface_t interface(binary, std::move(forest), std::cout);
+        binspector_interface_t interface(binary_path, std::move(forest), std::cout);
 
         interface.command_line();
     } else if (output_mode == "text") {
-        binspector_interface_t interface(binary, std::move(forest), std::cout);
+        binspector_interface_t interface(binary_path, std::move(forest), std::cout);
         bool                   ok_to_dump(true);
 
         if (!dump_path.empty()) {
@@ -243,16 +350,13 @@ int main(int argc, char** argv) try {
         else
             throw std::runtime_error("Text dump error.");
     } else if (output_mode == "html") {
-        binspector_html_dump(binary, std::move(forest), std::cout, outstream.str(), errstream.str());
+        binspector_html_dump(
+            binary_path, std::move(forest), std::cout, outstream.str(), errstream.str());
     } else if (output_mode == "validate") {
         std::cout << combostream.str();
     } else if (output_mode == "fuzz") {
         fuzz(*forest, binary_path, output_path, path_hash || fuzz_recurse, fuzz_recurse);
     } else if (output_mode == "dot") {
-        // at this point the source binary isn't needed for fuzzing
-        // so we can free it up.
-        binary.close();
-
         dot_graph(analyzer.structure_map(), starting_struct, output_path);
     } else {
         throw std::runtime_error(
@@ -28,6 +28,7 @@ namespace {
 #endif
 /*************************************************************************************************/
 
+CONSTANT_KEY(align);
 CONSTANT_KEY(big);
 CONSTANT_KEY(const);
 CONSTANT_KEY(default);
@@ -56,6 +57,7 @@ CONSTANT_KEY(typedef);
 CONSTANT_KEY(unsigned);
 CONSTANT_KEY(while);
 
+// align is only a keyword after a delimiter (see is_field_size), so it is not reserved here.
 adobe::name_t keyword_table[] = {
     key_big,    key_const,   key_default,    key_delimiter, key_die,      key_else,   key_enumerate,
     key_float,  key_if,      key_include,    key_invariant, key_invis,    key_little, key_noprint,
@@ -823,10 +825,11 @@ bool binspector_parser_t::is_field() {
     field_size_t   field_size_type(field_size_none_k);
     adobe::array_t offset_expression;
     adobe::array_t callback_expression;
+    adobe::array_t alignment_expression;
     bool           shuffleable(false);
 
-    is_field_size(field_size_type, field_size_expression, shuffleable); // optional
-    is_offset(offset_expression);                                       // optional
+    is_field_size(field_size_type, field_size_expression, alignment_expression, shuffleable);
+    is_offset(offset_expression); // optional
 
     try {
         static const adobe::array_t empty_array_k;
@@ -835,6 +838,7 @@ bool binspector_parser_t::is_field() {
         parameters[key_field_name].assign(field_identifier);
         parameters[key_field_size_type].assign(field_size_type);
         parameters[key_field_size_expression].assign(field_size_expression);
+        parameters[key_field_delimiter_alignment_expression].assign(alignment_expression);
         parameters[key_field_offset_expression].assign(offset_expression);
         parameters[key_field_shuffle].assign(shuffleable);
 
@@ -864,6 +868,7 @@ bool binspector_parser_t::is_field() {
 
 bool binspector_parser_t::is_field_size(field_size_t&   field_size_type,
                                         adobe::array_t& field_size_expression,
+                                        adobe::array_t& alignment_expression,
                                         bool&           shuffleable) {
     if (!is_token(adobe::open_bracket_k))
         return false;
@@ -886,6 +891,18 @@ bool binspector_parser_t::is_field_size(field_size_t&   field_size_type,
 
     require_expression(field_size_expression);
 
+    // a delimiter can be promised to only ever start some multiple of bytes into the array.
+    if (field_size_type == field_size_delimiter_k && is_token(adobe::comma_k)) {
+        adobe::name_t hint;
+
+        if (!is_identifier(hint) || hint != key_align)
+            throw_exception("align expected");
+
+        require_token(adobe::colon_k);
+
+        require_expression(alignment_expression);
+    }
+
     require_token(adobe::close_bracket_k);
 
     shuffleable = is_keyword(key_shuffle);